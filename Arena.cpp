@@ -0,0 +1,44 @@
+#include "Arena.h"
+#include <cstdint>
+#include <new>
+
+Arena::Arena()
+    : chunks(), next(nullptr), end(nullptr), allocations(0), bytes(0)
+{
+
+}
+
+Arena::~Arena()
+{
+    for(char* chunk : chunks)
+        ::operator delete(chunk);
+}
+
+char* Arena::addChunk(std::size_t size)
+{
+    char* chunk = static_cast<char*>(::operator new(size));
+    chunks.push_back(chunk);
+    return chunk;
+}
+
+void* Arena::allocate(std::size_t size, std::size_t align)
+{
+    ++allocations;
+    bytes += size;
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(next);
+    const std::size_t padding = (align - address % align) % align;
+    if(next && padding + size <= static_cast<std::size_t>(end - next)) {
+        char* result = next + padding;
+        next = result + size;
+        return result;
+    }
+    // Oversized requests get a chunk of their own, so the current one can
+    // still be used up
+    if(size > chunk_size / 4)
+        return addChunk(size);
+    next = addChunk(chunk_size);
+    end = next + chunk_size;
+    char* result = next;
+    next += size;
+    return result;
+}
@@ -0,0 +1,57 @@
+#ifndef _NOTENGLISH_ARENA_H_INCLUDE_GUARD
+#define _NOTENGLISH_ARENA_H_INCLUDE_GUARD
+
+#include <cstddef>
+#include <vector>
+#include "Symbols.h"
+
+/**
+ * A bump allocator: memory is taken from large chunks and only given back
+ * (all at once) when the ::Arena dies. Used for the nodes of a program,
+ * the names they use are kept in the Symbols::Table of the ::Arena.
+ * @see Ast::Program
+ */
+class Arena {
+    std::vector<char*> chunks;
+    char* next;
+    char* end;
+    std::size_t allocations;
+    std::size_t bytes;
+    Symbols::Table symbols;
+
+    static const std::size_t chunk_size = 64 * 1024;
+
+    char* addChunk(std::size_t size);
+public:
+    Arena();
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+
+    Symbols::Table& getSymbols()
+    {
+        return symbols;
+    }
+
+    std::size_t getAllocations() const
+    {
+        return allocations;
+    }
+
+    /**
+     * @return the number of bytes handed out
+     */
+    std::size_t getBytes() const
+    {
+        return bytes;
+    }
+
+    std::size_t getChunks() const
+    {
+        return chunks.size();
+    }
+};
+
+#endif // _NOTENGLISH_ARENA_H_INCLUDE_GUARD
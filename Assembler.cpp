@@ -0,0 +1,148 @@
+#include "Assembler.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace Jit {
+
+    Assembler::Assembler()
+        : code(), labels(), fixups()
+    {
+
+    }
+
+    void Assembler::byte(std::uint8_t b)
+    {
+        code.push_back(b);
+    }
+
+    void Assembler::dword(std::uint32_t d)
+    {
+        for(int i = 0; i < 4; ++i)
+            byte(d >> (8 * i));
+    }
+
+    void Assembler::sse(std::uint8_t prefix, std::uint8_t op, Reg reg, Reg rm)
+    {
+        byte(prefix);
+        if(reg >= 8 || rm >= 8)
+            byte(0x40 | (reg >= 8 ? 0x4 : 0) | (rm >= 8 ? 0x1 : 0));
+        byte(0x0f);
+        byte(op);
+        byte(0xc0 | (reg & 7) << 3 | (rm & 7));
+    }
+
+    void Assembler::sseFrame(std::uint8_t prefix, std::uint8_t op, Reg reg, std::int32_t disp)
+    {
+        byte(prefix);
+        if(reg >= 8)
+            byte(0x44);
+        byte(0x0f);
+        byte(op);
+        // mod 10 (disp32), rm 111 (rdi)
+        byte(0x80 | (reg & 7) << 3 | 0x7);
+        dword(disp);
+    }
+
+    Label Assembler::newLabel()
+    {
+        labels.push_back(-1);
+        return labels.size() - 1;
+    }
+
+    void Assembler::bind(Label l)
+    {
+        labels[l] = code.size();
+    }
+
+    void Assembler::load(Reg dst, std::int32_t disp)
+    {
+        sseFrame(0xf2, 0x10, dst, disp);
+    }
+
+    void Assembler::store(std::int32_t disp, Reg src)
+    {
+        sseFrame(0xf2, 0x11, src, disp);
+    }
+
+    void Assembler::loadConstant(Reg dst, double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        // mov rax, imm64
+        byte(0x48);
+        byte(0xb8);
+        dword(bits);
+        dword(bits >> 32);
+        // movq dst, rax
+        byte(0x66);
+        byte(0x48 | (dst >= 8 ? 0x4 : 0));
+        byte(0x0f);
+        byte(0x6e);
+        byte(0xc0 | (dst & 7) << 3);
+    }
+
+    void Assembler::add(Reg dst, Reg src)
+    {
+        sse(0xf2, 0x58, dst, src);
+    }
+
+    void Assembler::sub(Reg dst, Reg src)
+    {
+        sse(0xf2, 0x5c, dst, src);
+    }
+
+    void Assembler::mul(Reg dst, Reg src)
+    {
+        sse(0xf2, 0x59, dst, src);
+    }
+
+    void Assembler::div(Reg dst, Reg src)
+    {
+        sse(0xf2, 0x5e, dst, src);
+    }
+
+    void Assembler::xorpd(Reg dst, Reg src)
+    {
+        sse(0x66, 0x57, dst, src);
+    }
+
+    void Assembler::compare(Reg lhs, Reg rhs)
+    {
+        sse(0x66, 0x2e, lhs, rhs);
+    }
+
+    void Assembler::jump(Label target)
+    {
+        byte(0xe9);
+        fixups.push_back(std::make_pair(code.size(), target));
+        dword(0);
+    }
+
+    void Assembler::jump(Cond c, Label target)
+    {
+        byte(0x0f);
+        byte(0x80 | static_cast<std::uint8_t>(c));
+        fixups.push_back(std::make_pair(code.size(), target));
+        dword(0);
+    }
+
+    void Assembler::ret()
+    {
+        byte(0xc3);
+    }
+
+    const std::vector<std::uint8_t>& Assembler::finish()
+    {
+        for(const auto& fixup : fixups) {
+            if(labels[fixup.second] < 0)
+                throw std::logic_error("jump to an unbound label");
+            // Relative to the end of the rel32 operand
+            const std::ptrdiff_t rel = labels[fixup.second] - (fixup.first + 4);
+            const std::uint32_t value = static_cast<std::uint32_t>(static_cast<std::int32_t>(rel));
+            for(int i = 0; i < 4; ++i)
+                code[fixup.first + i] = value >> (8 * i);
+        }
+        fixups.clear();
+        return code;
+    }
+}
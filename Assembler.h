@@ -0,0 +1,75 @@
+#ifndef _NOTENGLISH_ASSEMBLER_H_INCLUDE_GUARD
+#define _NOTENGLISH_ASSEMBLER_H_INCLUDE_GUARD
+
+#include <cstdint>
+#include <vector>
+
+namespace Jit {
+
+    /**
+     * An SSE register (xmm0 to xmm15).
+     */
+    typedef std::uint8_t Reg;
+    typedef std::size_t Label;
+
+    const Reg register_count = 16;
+
+    /**
+     * Condition codes of the conditional jumps (the low nibble of Jcc).
+     */
+    enum class Cond : std::uint8_t {
+        Below = 0x2, AboveEqual = 0x3, Equal = 0x4, NotEqual = 0x5,
+        BelowEqual = 0x6, Above = 0x7, Parity = 0xa, NoParity = 0xb
+    };
+
+    /**
+     * Writes the few x86-64 instructions the ::Jit needs into a buffer: scalar
+     * double arithmetic on the SSE registers, loads and stores relative to
+     * the frame pointer (rdi, the first argument of the generated function)
+     * and jumps to labels, which are patched once all code is written.
+     */
+    class Assembler {
+        std::vector<std::uint8_t> code;
+        // The offset of each label, -1 while it is unbound
+        std::vector<std::ptrdiff_t> labels;
+        // The offsets of the rel32 operands referring to each label
+        std::vector< std::pair<std::size_t, Label> > fixups;
+
+        void byte(std::uint8_t b);
+        void dword(std::uint32_t d);
+        // prefix [REX] 0F op, with register operands
+        void sse(std::uint8_t prefix, std::uint8_t op, Reg reg, Reg rm);
+        // prefix [REX] 0F op, with the operand [rdi + disp32]
+        void sseFrame(std::uint8_t prefix, std::uint8_t op, Reg reg, std::int32_t disp);
+    public:
+        Assembler();
+
+        Label newLabel();
+        void bind(Label l);
+
+        // movsd reg, [rdi + disp]
+        void load(Reg dst, std::int32_t disp);
+        // movsd [rdi + disp], reg
+        void store(std::int32_t disp, Reg src);
+        // Loads a constant through rax
+        void loadConstant(Reg dst, double value);
+        void add(Reg dst, Reg src);
+        void sub(Reg dst, Reg src);
+        void mul(Reg dst, Reg src);
+        void div(Reg dst, Reg src);
+        void xorpd(Reg dst, Reg src);
+        // ucomisd, sets ZF, PF and CF (all three if unordered)
+        void compare(Reg lhs, Reg rhs);
+        void jump(Label target);
+        void jump(Cond c, Label target);
+        void ret();
+
+        /**
+         * Resolves the jumps.
+         * @return the machine code
+         */
+        const std::vector<std::uint8_t>& finish();
+    };
+}
+
+#endif // _NOTENGLISH_ASSEMBLER_H_INCLUDE_GUARD
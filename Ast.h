@@ -3,35 +3,170 @@
 
 #include "TokenStream.h"
 #include "DataHandler.h"
+#include "Bytecode.h"
+#include "Jit.h"
+#include "Arena.h"
+#include "Profiler.h"
 #include <vector>
 #include <deque>
 #include <memory>
 #include <sstream>
 
+namespace Bytecode {
+    class Compiler;
+}
+
+class Resolver;
+class Optimizer;
+
 namespace Ast {
 
     class Node {
     protected:
         TokenType type;
+        // The source line of a statement, 0 for other nodes
+        int line;
     public:
         Node(const TokenType& t = TokenType::Unkown)
-            : type(t) {}
-        virtual VarPtr execute() = 0;
+            : type(t), line(0) {}
+
+        int getLine() const
+        {
+            return line;
+        }
+
+        void setLine(int l)
+        {
+            line = l;
+        }
+        /**
+         * Executes this node. Expressions evaluate to their ::Value,
+         * statements to an empty one.
+         */
+        virtual Value execute() = 0;
+        /**
+         * Evaluates this node as a function argument, which is passed by
+         * reference if it refers to a variable.
+         */
+        virtual VarPtr reference()
+        {
+            return make_variable(execute());
+        }
         virtual void cleanup() {};
+        /**
+         * Evaluates this node to a number without making a ::Value, the
+         * fast path of arithmetic. Only nodes without side effects do, so
+         * a node failing can be evaluated again by Node::execute.
+         * @return false if this node is no number (or may have side
+         *  effects)
+         */
+        virtual bool number(Value::NumberType& out)
+        {
+            return false;
+        }
+        /**
+         * Binds the names used by this node.
+         * @see Resolver.cpp
+         */
+        virtual void resolve(Resolver& r) = 0;
+        /**
+         * Binds the names used by this node as a function argument, which
+         * may be changed through its reference.
+         */
+        virtual void resolveArg(Resolver& r)
+        {
+            resolve(r);
+        }
+        /**
+         * Marks this node as the last one run by a function body, inside
+         * \a scopes scopes of that body (see FunctionCall::execute).
+         */
+        virtual void markTail(int scopes) {}
+        /**
+         * Simplifies this node and its children.
+         * @return the node replacing this one, nullptr to keep it
+         * @see Optimizer.cpp
+         */
+        virtual Node* fold(Optimizer& o) = 0;
+        /**
+         * @return the value of a literal, nullptr for any other node
+         */
+        virtual const Value* literal() const
+        {
+            return nullptr;
+        }
+        /**
+         * Lowers this node to bytecode. Nodes producing a value leave it in
+         * register \a dst.
+         * @see Compiler.cpp
+         */
+        virtual void compile(Bytecode::Compiler& c, Bytecode::Reg dst) = 0;
+        /**
+         * Lowers this node as a function argument, which pushes it on the
+         * argument stack (by reference if possible).
+         */
+        virtual void compileArg(Bytecode::Compiler& c);
+        /**
+         * Lowers this node to machine code, nodes producing a number leave
+         * it in register \a dst.
+         * @return false if the ::Jit cannot handle this node
+         * @see Jit.cpp
+         */
+        virtual bool jit(Jit::Compiler& j, Jit::Reg dst)
+        {
+            return false;
+        }
+        /**
+         * Lowers a condition to machine code jumping to \a target if it is
+         * \a when.
+         * @return false if the ::Jit cannot handle this node
+         */
+        virtual bool jitBranch(Jit::Compiler& j, bool when, Jit::Label target)
+        {
+            return false;
+        }
         virtual ~Node() {}
         Node(const Node&) = delete;
         Node& operator=(const Node&) = delete;
+
+        /**
+         * Nodes are only allocated in an ::Arena (new (arena) Literal(...)),
+         * deleting one runs its destructor but leaves the memory to the
+         * ::Arena. The names nodes keep a reference to are interned in the
+         * Symbols::Table of the same ::Arena.
+         */
+        static void* operator new(std::size_t size, Arena& arena)
+        {
+            return arena.allocate(size);
+        }
+        static void operator delete(void*, Arena&) {}
+        static void operator delete(void*) {}
     };
 
     typedef std::unique_ptr<Node> NodePtr;
 
+    /**
+     * The types of operands an operator has seen, the feedback deciding
+     * whether it takes the fast path for numbers (Node::number). Once that
+     * fails the operator sticks to the generic path.
+     */
+    enum class Operands : std::uint8_t {
+        Unseen, Numbers, Mixed
+    };
+
     class Block : public Node {
         std::deque<NodePtr> stmnts;
         DataHandler* data;
         bool scope;
+        // The variables of its ::Scope
+        SlotNames names;
+        // The name of the function this is the body of, if any
+        const std::string* function;
+
+        void resolveStatements(Resolver& r);
     public:
         Block(DataHandler* d)
-            : Node(), stmnts(), data(d), scope(false) {}
+            : Node(), stmnts(), data(d), scope(false), names(), function(nullptr) {}
 
         template <class NodeType>
         void prepend(NodeType* n)
@@ -45,68 +180,177 @@ namespace Ast {
             stmnts.emplace_back(n);
         }
 
-        void premakeScope()
+        /**
+         * @return the last statement, nullptr if there is none
+         */
+        Node* back() const
+        {
+            return stmnts.empty() ? nullptr : stmnts.back().get();
+        }
+
+        std::size_t size() const
+        {
+            return stmnts.size();
+        }
+
+        const std::string* getFunction() const
         {
-            data->addScope();
+            return function;
+        }
+
+        void setFunction(const std::string* name)
+        {
+            function = name;
+        }
+
+        /**
+         * Moves the statements out of the block, for running them one by
+         * one in the ::Scope of another block (see ::Streamer).
+         */
+        std::deque<NodePtr> takeStatements()
+        {
+            std::deque<NodePtr> result;
+            result.swap(stmnts);
+            return result;
+        }
+
+        /**
+         * Makes the ::Scope of a function call (whose parent is the ::Scope
+         * the function was declared in).
+         */
+        void premakeScope(ScopeIndex parent)
+        {
+            data->addScope(names, parent);
             scope = true;
-        } 
+        }
+
+        const SlotNames& getNames() const
+        {
+            return names;
+        }
 
-        VarPtr execute()
+        Value execute()
         {
             if(!scope)
-                data->addScope();
-            for(auto& n : stmnts)
+                data->addScope(names);
+            for(auto& n : stmnts) {
+                Profiler::at(n->getLine());
                 n->execute();
+            }
             cleanup(); // Execution done, cleanup
-            return VarPtr();
+            return Value();
         }
 
         void cleanup()
         {
-            for(auto& n : stmnts)
-                n->cleanup();
+            // Takes the variables and functions of the block with it
             data->popScope();
             scope = false;
         }
+
+        void resolve(Resolver& r);
+        void markTail(int scopes);
+        Node* fold(Optimizer& o);
+        /**
+         * Resolves the body of a function, with its arguments in the first
+         * slots.
+         */
+        void resolveFunction(Resolver& r, const std::vector<std::string>& args);
+
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        /**
+         * Compiles the statements only, the ::Scope has to be made by the
+         * caller (like Block::premakeScope).
+         */
+        void compileStatements(Bytecode::Compiler& c);
+        bool jit(Jit::Compiler& j, Jit::Reg dst);
     };
 
     class Expression : public Node {
         NodePtr left;
         NodePtr right;
         char op;
+        Operands seen;
     public:
         Expression()
-            : Node(), left(), right(), op() {}
+            : Node(), left(), right(), op(), seen(Operands::Unseen) {}
 
         template<class NodeType>
         Expression(NodeType* l)
-            : Node(), left(l), right(), op() {}
+            : Node(), left(l), right(), op(), seen(Operands::Unseen) {}
 
         template<class NodeType1, class NodeType2>
         Expression(NodeType1* l, NodeType2* r, char o)
-            : Node(), left(l), right(r), op(o) {}
-        VarPtr execute()
+            : Node(), left(l), right(r), op(o), seen(Operands::Unseen) {}
+        Value execute()
         {
-            VarPtr vleft = left->execute();
             if(!right)
-                return vleft;
-            const VarPtr vright = right->execute();
+                return left->execute();
+            if(seen == Operands::Numbers) {
+                Value::NumberType n;
+                if(number(n))
+                    return n;
+                seen = Operands::Mixed;
+            }
+            const Value vleft = left->execute();
+            const Value vright = right->execute();
+            if(seen == Operands::Unseen)
+                seen = vleft.isNumber() && vright.isNumber() ? Operands::Numbers : Operands::Mixed;
             switch(op) {
                 case '+':
-                    return Variable::apply(AdditionVisitor(), *vleft, *vright).clone();
+                    return Value::add(vleft, vright);
                 case '-':
-                    return Variable::apply(SubtractionVisitor(), *vleft, *vright).clone();
+                    return Value::subtract(vleft, vright);
                 case '*':
-                    return Variable::apply(MultiplicationVisitor(), *vleft, *vright).clone();
+                    return Value::multiply(vleft, vright);
                 case '/':
-                    return Variable::apply(DivisionVisitor(), *vleft, *vright).clone();
+                    return Value::divide(vleft, vright);
                 default:
                     std::stringstream ss("Invalid operator ");
                     ss << op;
                     throw std::runtime_error(ss.str().c_str());
-                    return VarPtr();
+                    return Value();
                 }
         }
+
+        bool number(Value::NumberType& out)
+        {
+            if(!right)
+                return left->number(out);
+            Value::NumberType l, r;
+            if(!left->number(l) || !right->number(r))
+                return false;
+            switch(op) {
+                case '+':
+                    out = l + r;
+                    return true;
+                case '-':
+                    out = l - r;
+                    return true;
+                case '*':
+                    out = l * r;
+                    return true;
+                case '/':
+                    out = l / r;
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        VarPtr reference()
+        {
+            // A lone operand keeps referring to the same variable
+            if(!right)
+                return left->reference();
+            return Node::reference();
+        }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        void resolveArg(Resolver& r);
+        Node* fold(Optimizer& o);
+        void compileArg(Bytecode::Compiler& c);
+        bool jit(Jit::Compiler& j, Jit::Reg dst);
     };
 
     class UnaryOp : public Node {
@@ -120,151 +364,242 @@ namespace Ast {
         UnaryOp(NodeType* n, char o = '\0')
             : Node(), sub(n), op(o) {}
 
-        VarPtr execute()
+        Value execute()
         {
             if(op == '-')
-                return Variable::apply(UnaryMinusVisitor(), *sub->execute()).clone();
+                return Value::negate(sub->execute());
             else
                 return sub->execute();
         }
+
+        bool number(Value::NumberType& out)
+        {
+            if(!sub->number(out))
+                return false;
+            if(op == '-')
+                out = -out;
+            return true;
+        }
+
+        VarPtr reference()
+        {
+            if(op == '-')
+                return Node::reference();
+            return sub->reference();
+        }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        void resolveArg(Resolver& r);
+        Node* fold(Optimizer& o);
+        void compileArg(Bytecode::Compiler& c);
+        bool jit(Jit::Compiler& j, Jit::Reg dst);
     };
 
     class Condition : public Node {
         NodePtr left;
         NodePtr right;
         char op;
+        Operands seen;
+
+        /**
+         * Compares two numbers, \a op is one of the comparisons.
+         */
+        bool compare(Value::NumberType l, Value::NumberType r) const
+        {
+            switch(op) {
+                case '=':
+                    return l == r;
+                case '!':
+                    return l != r;
+                case '<':
+                    return l < r;
+                default:
+                    return l > r;
+            }
+        }
     public:
         Condition()
-            : Node(), left(), right(), op() {}
+            : Node(), left(), right(), op(), seen(Operands::Unseen) {}
         template<class NodeType1, class NodeType2>
         Condition(NodeType1* l, NodeType2* r, char o)
-            : Node(), left(l), right(r), op(o) {}
-        VarPtr execute()
+            : Node(), left(l), right(r), op(o), seen(Operands::Unseen) {}
+        Value execute()
         {
-            VarPtr vleft = left->execute();
-            const VarPtr vright = right->execute();
+            if(seen == Operands::Numbers) {
+                Value::NumberType l, r;
+                if(left->number(l) && right->number(r))
+                    return compare(l, r);
+                seen = Operands::Mixed;
+            }
+            const Value vleft = left->execute();
+            const Value vright = right->execute();
+            // The logical operators have no fast path
+            if(seen == Operands::Unseen)
+                seen = op != '&' && op != '|' && vleft.isNumber() && vright.isNumber()
+                    ? Operands::Numbers : Operands::Mixed;
             switch(op) {
                 case '&':
-                    return Variable::apply(AndVisitor(), *vleft, *vright).clone();
+                    return Value::logicalAnd(vleft, vright);
                 case '|':
-                    return Variable::apply(OrVisitor(), *vleft, *vright).clone();
+                    return Value::logicalOr(vleft, vright);
                 case '=':
-                    return Variable::apply(EqualsVisitor(), *vleft, *vright).clone();
+                    return Value::equals(vleft, vright);
                 case '!':
-                    return Variable::apply(NotEqualsVisitor(), *vleft, *vright).clone();
+                    return Value::notEquals(vleft, vright);
                 case '<':
-                    return Variable::apply(SmallerThanVisitor(), *vleft, *vright).clone();
+                    return Value::smaller(vleft, vright);
                 case '>':
-                    return Variable::apply(GreaterThanVisitor(), *vleft, *vright).clone();
+                    return Value::greater(vleft, vright);
                 default:
                     std::stringstream ss("Invalid operator ");
                     ss << op;
                     throw std::runtime_error(ss.str().c_str());
-                    return VarPtr();
+                    return Value();
             }
         }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        Node* fold(Optimizer& o);
+        bool jitBranch(Jit::Compiler& j, bool when, Jit::Label target);
     };
 
     class Literal : public Node {
-        VarPtr val;
+        Value val;
     public:
         Literal()
             : Node(), val() {}
-        
-        Literal(VarPtr p)
-            : Node(), val(p) {}
 
-        template<class T>
-        Literal(const T& v)
-            : Node(), val(new Variable(v)) {}
-        VarPtr execute()
+        Literal(const Value& v)
+            : Node(), val(v) {}
+
+        Value execute()
         {
             return val;
         }
+
+        const Value* literal() const
+        {
+            return &val;
+        }
+
+        bool number(Value::NumberType& out)
+        {
+            if(!val.isNumber())
+                return false;
+            out = val.number();
+            return true;
+        }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        Node* fold(Optimizer& o);
+        void compileArg(Bytecode::Compiler& c);
+        bool jit(Jit::Compiler& j, Jit::Reg dst);
+        bool jitBranch(Jit::Compiler& j, bool when, Jit::Label target);
     };
 
     class FunctionCall : public Node {
-        std::string name;
-        std::vector< std::unique_ptr<Expression> > args;
+        const std::string& name;
+        std::vector<NodePtr> args;
         DataHandler* data;
+        CallSite site;
+        // The scopes left before the function returns, 0 if this is no
+        // tail call
+        int tail;
     public:
         FunctionCall(const std::string& n, DataHandler* d)
-            : Node(), name(n), data(d) {}
+            : Node(), name(n), args(), data(d), site(), tail(0) {}
 
-        void addArgument(Expression* arg)
+        void addArgument(Node* arg)
         {
             args.emplace_back(arg);
         }
 
-        VarPtr execute()
+        Value execute()
         {
-            if(!data->funcExists(name)) {
+            if(!data->lookup(name, site)) {
                 throw std::runtime_error("use of nonexistant function " + name);
-                return VarPtr();
+                return Value();
             }
-            std::vector<VarPtr> vargs;
+            arg_t vargs;
             vargs.reserve(args.size());
             for(auto& arg : args)
-                vargs.push_back(arg->execute());
-            return data->call(name, vargs);
+                vargs.push_back(arg->reference());
+            // The arguments may have called functions and changed the epoch,
+            // those functions are gone again (the site is still valid)
+            if(tail && site.func && data->deferCall(site.func, vargs, tail))
+                return Value();
+            return data->call(site, vargs);
+        }
+
+        void markTail(int scopes)
+        {
+            tail = scopes;
         }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        Node* fold(Optimizer& o);
 
         // Cleanup is handled by the ::DataHandler
     };
 
     class Assignment : public Node {
         DataHandler* data;
-        std::string name;
-        std::unique_ptr<Expression> value;
+        const std::string& name;
+        NodePtr value;
+        Binding binding;
     public:
-        Assignment()
-            : Node(), data(), name(), value() {}
-
-        Assignment(const std::string& n, DataHandler* d, Expression* e)
-            : Node(), data(d), name(n), value(e) {}
-        VarPtr execute()
+        Assignment(const std::string& n, DataHandler* d, Node* e)
+            : Node(), data(d), name(n), value(e), binding() {}
+        Value execute()
         {
-            if(data->varExists(name))
-                data->set(name, value->execute());
-            else
+            if(!binding.resolved()) {
+                // A variable of a caller (which has to exist first)
+                data->getVar(name);
+                const Value v = value->execute();
+                *data->getVar(name) = v;
+                return Value();
+            }
+            if(!data->getVar(binding))
                 throw std::runtime_error("Undefined variable " + name + " used.");
-            return VarPtr();
+            // Calls made by the value move the slots
+            const Value v = value->execute();
+            *data->getVar(binding) = v;
+            return Value();
         }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        Node* fold(Optimizer& o);
+        bool jit(Jit::Compiler& j, Jit::Reg dst);
     };
 
     class VarDeclaration : public Node {
         DataHandler* data;
-        std::string name;
+        const std::string& name;
+        Binding binding;
+        // A variable with the same name in an enclosing scope
+        Binding shadowed;
     public:
-        VarDeclaration()
-            : Node(), data(), name() {}
-
         VarDeclaration(const std::string& n, DataHandler* d)
-            : Node(), data(d), name(n)  {}
+            : Node(), data(d), name(n), binding(), shadowed()  {}
 
-        VarPtr execute()
+        Value execute()
         {
-            if(!data->varExists(name))
-                data->addVar(name);
-            else
+            VarPtr& var = data->getVar(binding);
+            if(var || (shadowed.resolved() && data->getVar(shadowed)))
                 throw std::runtime_error("Variable " + name + " double declared.");
-            return VarPtr();
-        }
-
-        void cleanup()
-        {
-            data->delVar(name);
+            var = make_variable(Value());
+            return Value();
         }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        Node* fold(Optimizer& o);
     };
 
     class FuncDeclaration : public Node {
         DataHandler* data;
-        std::string name;
+        const std::string& name;
         std::vector<std::string> args;
     public:
-        FuncDeclaration()
-            : Node(), data(nullptr), name(), args() {}
-
         FuncDeclaration(const std::string& n, DataHandler* d)
             : Node(), data(d), name(n), args()  {}
 
@@ -273,91 +608,211 @@ namespace Ast {
             args.push_back(name);
         }
 
-        VarPtr execute()
+        Value execute()
         {
             if(!data->funcExists(name))
                 data->addFunc(name, args);
             else
                 throw std::runtime_error("Function " + name + " double declared.");
-            return VarPtr();
-        }
-
-        void cleanup()
-        {
-            data->delFunc(name);
+            return Value();
         }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        Node* fold(Optimizer& o);
     };
 
     class FuncImpl : public Node {
         DataHandler* data;
-        std::string name;
+        const std::string& name;
         std::unique_ptr<Block> body;
+        // Depth of the scope declaring the function
+        int home;
     public:
-        FuncImpl()
-            : Node(), data(nullptr), name(), body(nullptr) {}
-
         FuncImpl(const std::string& n, DataHandler* d, Block* b)
-            : Node(), data(d), name(n), body(b)  {}
+            : Node(), data(d), name(n), body(b), home(-1)
+        {
+            body->setFunction(&name);
+        }
 
-        VarPtr execute()
+        Value execute()
         {
-            if(data->funcExists(name))
-                data->getFunc(name).setBody(body.get());
-            else
+            // The body was resolved for the declaration found by the
+            // ::Resolver, so it may only be attached to that one
+            Function* func = data->findFunc(name);
+            if(!func || home < 0 || func->getHome() != data->getScope(home))
                 throw std::runtime_error("Undefined function " + name + " used.");
-            return VarPtr();
+            func->setBody(body.get());
+            return Value();
         }
+
+        /**
+         * Resolves the body, called by the ::Resolver once the scope
+         * declaring the function is complete.
+         */
+        void resolveBody(Resolver& r, const std::vector<std::string>& args);
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        Node* fold(Optimizer& o);
     };
 
     class VarNode : public Node {
         DataHandler* data;
-        std::string name;
+        const std::string& name;
+        Binding binding;
+        // Whether this is one of the built-in constants
+        bool builtin;
     public:
-        VarNode()
-            : Node(), data(nullptr), name() {}
-
         VarNode(const std::string& n, DataHandler* d)
-            : Node(), data(d), name(n) {}
-        VarPtr execute()
+            : Node(), data(d), name(n), binding(), builtin(false) {}
+        Value execute()
         {
-            if(data->varExists(name))
+            if(!binding.resolved())
+                return *data->getVar(name);
+            const VarPtr& var = data->getVar(binding);
+            if(!var)
+                throw std::runtime_error("Undefined variable " + name + " used.");
+            return *var;
+        }
+
+        VarPtr reference()
+        {
+            if(!binding.resolved())
                 return data->getVar(name);
-            throw std::runtime_error("Undefined variable " + name + " used.");
+            const VarPtr& var = data->getVar(binding);
+            if(!var)
+                throw std::runtime_error("Undefined variable " + name + " used.");
+            return var;
+        }
+
+        bool number(Value::NumberType& out)
+        {
+            if(!binding.resolved())
+                return false;
+            const VarPtr& var = data->getVar(binding);
+            if(!var || !var->isNumber())
+                return false;
+            out = var->number();
+            return true;
         }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        void resolveArg(Resolver& r);
+        Node* fold(Optimizer& o);
+        void compileArg(Bytecode::Compiler& c);
+        bool jit(Jit::Compiler& j, Jit::Reg dst);
     };
 
     class IfStatement : public Node {
-        std::unique_ptr<Condition> condition;
+        NodePtr condition;
         std::unique_ptr<Block> body_if;
         std::unique_ptr<Block> body_else;
     public:
         IfStatement()
             : Node(), condition(), body_if(), body_else() {}
-        IfStatement(Condition* c, Block* bi, Block* be)
+        IfStatement(Node* c, Block* bi, Block* be)
             : Node(), condition(c), body_if(bi), body_else(be) {}
-        VarPtr execute()
+        Value execute()
         {
-            if(condition->execute()->getValue<Variable::BoolType>())
+            if(condition->execute().getValue<Value::BoolType>())
                 body_if->execute();
             else if(body_else)
                 body_else->execute();
-            return VarPtr();
+            return Value();
         }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        void markTail(int scopes);
+        Node* fold(Optimizer& o);
+        bool jit(Jit::Compiler& j, Jit::Reg dst);
     };
 
     class WhileStatement : public Node {
-        std::unique_ptr<Condition> condition;
+        NodePtr condition;
         std::unique_ptr<Block> body;
+        DataHandler* data;
+        Jit::Loop native;
+
+        /**
+         * Compiles the loop to machine code, once it is hot.
+         */
+        void compileNative();
     public:
         WhileStatement()
-            : Node(), condition(), body() {}
-        WhileStatement(Condition* c, Block* b)
-            : Node(), condition(c), body(b) {}
-        VarPtr execute()
+            : Node(), condition(), body(), data(nullptr), native() {}
+        WhileStatement(Node* c, Block* b, DataHandler* d)
+            : Node(), condition(c), body(b), data(d), native() {}
+        Value execute()
         {
-            while(condition->execute()->getValue<Variable::BoolType>())
+            if(native.run(*data))
+                return Value();
+            while(condition->execute().getValue<Value::BoolType>()) {
                 body->execute();
-            return VarPtr();
+                Profiler::at(line);
+                // The rest of the iterations run natively if possible
+                if(native.hot()) {
+                    compileNative();
+                    if(native.run(*data))
+                        break;
+                }
+            }
+            return Value();
+        }
+        void compile(Bytecode::Compiler& c, Bytecode::Reg dst);
+        void resolve(Resolver& r);
+        Node* fold(Optimizer& o);
+        bool jit(Jit::Compiler& j, Jit::Reg dst);
+    };
+
+    /**
+     * A parsed program: the root ::Ast::Block and the ::Arena all of its
+     * nodes live in, which is freed in one go with the program. Parts
+     * parsed on other threads have arenas of their own (see
+     * Program::addArena).
+     */
+    class Program {
+        Arena arena;
+        std::vector<std::unique_ptr<Arena> > parts;
+        std::unique_ptr<Block> root;
+    public:
+        Program()
+            : arena(), parts(), root() {}
+
+        Arena& getArena()
+        {
+            return arena;
+        }
+
+        const Arena& getArena() const
+        {
+            return arena;
+        }
+
+        /**
+         * @return another ::Arena for nodes of the program, which lives as
+         *  long as the program does
+         */
+        Arena& addArena()
+        {
+            parts.emplace_back(new Arena());
+            return *parts.back();
+        }
+
+        /**
+         * @return the arenas added by Program::addArena
+         */
+        const std::vector<std::unique_ptr<Arena> >& getArenas() const
+        {
+            return parts;
+        }
+
+        Block& getRoot()
+        {
+            return *root;
+        }
+
+        void setRoot(Block* b)
+        {
+            root.reset(b);
         }
     };
 }
@@ -0,0 +1,144 @@
+#include "Batch.h"
+#include "Compiler.h"
+#include "Optimizer.h"
+#include "ParallelParser.h"
+#include "Resolver.h"
+#include "VM.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+
+    bool isDirectory(const std::string& path)
+    {
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+
+    /**
+     * Adds the programs in the directory \a path to \a scripts.
+     */
+    void listPrograms(const std::string& path, std::vector<std::string>& scripts)
+    {
+        DIR* dir = ::opendir(path.c_str());
+        if(!dir)
+            throw std::runtime_error("could not read directory \"" + path + "\"");
+        std::vector<std::string> names;
+        while(const struct dirent* entry = ::readdir(dir)) {
+            const std::string name = entry->d_name;
+            if(name.size() > 4 && name.compare(name.size() - 4, 4, ".ext") == 0)
+                names.push_back(name);
+        }
+        ::closedir(dir);
+        std::sort(names.begin(), names.end());
+        const std::string prefix = path.back() == '/' ? path : path + '/';
+        for(const std::string& name : names) {
+            if(!isDirectory(prefix + name))
+                scripts.push_back(prefix + name);
+        }
+    }
+
+    struct Result {
+        std::string out;
+        std::string err;
+        bool failed;
+        bool done;
+
+        Result()
+            : out(), err(), failed(false), done(false) {}
+    };
+
+    /**
+     * Runs the program in \a path like the interpreter does on its own,
+     * into \a result.
+     */
+    void runScript(const std::string& path, const std::string& engine, bool optimize,
+                   Result& result)
+    {
+        std::ostringstream log;
+        setErrorLog(&log);
+        Output::Stream output([&result](const char* data, std::size_t size) {
+            result.out.append(data, size);
+        });
+        try {
+            DataHandler data;
+            data.setIO(output, [](std::string&) { return false; });
+            Ast::Program program;
+            program.setRoot(ParallelParser(path, data, 1).run(program));
+            Resolver resolver(data);
+            resolver.resolve(program.getRoot());
+            if(optimize)
+                Optimizer(data, resolver, program.getArena()).optimize(program.getRoot());
+            if(engine == "vm") {
+                Bytecode::Program code;
+                Bytecode::Compiler(code).compileProgram(program.getRoot());
+                Bytecode::VM(data, code).execute();
+            } else {
+                program.getRoot().execute();
+            }
+        } catch(const std::exception& e) {
+            result.failed = true;
+            log << "exception caught: " << e.what() << std::endl;
+        }
+        output.flush();
+        setErrorLog(nullptr);
+        result.err = log.str();
+    }
+}
+
+BatchRunner::BatchRunner(const std::vector<std::string>& paths, const std::string& e,
+                         bool o, unsigned j)
+    : scripts(), engine(e), optimize(o), jobs(std::max(j, 1u))
+{
+    for(const std::string& path : paths) {
+        if(isDirectory(path))
+            listPrograms(path, scripts);
+        else
+            scripts.push_back(path);
+    }
+}
+
+std::size_t BatchRunner::run(std::ostream& out, std::ostream& err)
+{
+    std::vector<Result> results(scripts.size());
+    std::atomic<std::size_t> next(0);
+    // The results are printed in order, by whichever thread completes the
+    // first one not printed yet
+    std::mutex lock;
+    std::size_t printed = 0;
+    std::size_t failed = 0;
+    auto work = [&]() {
+        for(std::size_t i; (i = next++) < scripts.size();) {
+            runScript(scripts[i], engine, optimize, results[i]);
+            std::lock_guard<std::mutex> guard(lock);
+            results[i].done = true;
+            for(; printed < results.size() && results[printed].done; ++printed) {
+                Result& r = results[printed];
+                out << "==> " << scripts[printed] << " <==\n" << r.out;
+                if(!r.err.empty())
+                    err << "==> " << scripts[printed] << " <==\n" << r.err;
+                if(r.failed)
+                    ++failed;
+                // Printed output is not kept
+                r = Result();
+                r.done = true;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    const std::size_t count = std::min<std::size_t>(jobs, scripts.size());
+    for(std::size_t t = 1; t < count; ++t)
+        threads.emplace_back(work);
+    work();
+    for(std::thread& t : threads)
+        t.join();
+    out.flush();
+    return failed;
+}
@@ -0,0 +1,50 @@
+/**
+ * @file Batch.h Runs many programs side by side in one process.
+ */
+#ifndef _NOTENGLISH_BATCH_H_INCLUDE_GUARD
+#define _NOTENGLISH_BATCH_H_INCLUDE_GUARD
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/**
+ * Runs a list of programs on a pool of threads, each with a ::DataHandler
+ * (and so a scope, functions and output) of its own. A program reads no
+ * input, what it writes and the errors it reports are captured and
+ * printed once it is done, in the order of the list, each under a header
+ * with its name.
+ *
+ * The threads take the next program as soon as they are free, so a few
+ * long programs do not hold up the short ones behind them.
+ */
+class BatchRunner {
+    std::vector<std::string> scripts;
+    std::string engine;
+    bool optimize;
+    unsigned jobs;
+public:
+    /**
+     * @param paths programs and directories, whose programs (the files
+     *  ending in ".ext") are run in the order of their names
+     * @param engine "ast" or "vm"
+     * @throw std::runtime_error if a directory cannot be read
+     */
+    BatchRunner(const std::vector<std::string>& paths, const std::string& engine,
+                bool optimize, unsigned jobs);
+
+    const std::vector<std::string>& getScripts() const
+    {
+        return scripts;
+    }
+
+    /**
+     * Runs all programs, their output goes to \a out and their errors to
+     * \a err.
+     * @return the number of programs that failed
+     */
+    std::size_t run(std::ostream& out, std::ostream& err);
+};
+
+#endif // _NOTENGLISH_BATCH_H_INCLUDE_GUARD
@@ -0,0 +1,112 @@
+/**
+ * @file Bytecode.h Describes the register based bytecode that an Ast::Block
+ * can be lowered to (see Compiler.h) and executed by the Bytecode::VM.
+ */
+#ifndef _NOTENGLISH_BYTECODE_H_INCLUDE_GUARD
+#define _NOTENGLISH_BYTECODE_H_INCLUDE_GUARD
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Variable.h"
+
+/**
+ * All opcodes understood by the Bytecode::VM. The operands are described as
+ * (a, b, c), registers are written as r[x] and variables as (depth, slot)
+ * (see ::Binding).
+ * The list is kept as an X-macro so the VM's dispatch table can never get out
+ * of sync with the enumeration.
+ */
+#define NOTENGLISH_OPCODES(X)                                               \
+    X(LoadConst)     /* r[a] = constants[c]                              */ \
+    X(LoadVar)       /* r[a] = variable (b, c)                           */ \
+    X(StoreVar)      /* variable (b, c) = r[a]                           */ \
+    X(Add)           /* r[a] = r[b] + r[c]                               */ \
+    X(Sub)           /* r[a] = r[b] - r[c]                               */ \
+    X(Mul)           /* r[a] = r[b] * r[c]                               */ \
+    X(Div)           /* r[a] = r[b] / r[c]                               */ \
+    X(Neg)           /* r[a] = -r[b]                                     */ \
+    X(And)           /* r[a] = r[b] && r[c]                              */ \
+    X(Or)            /* r[a] = r[b] || r[c]                              */ \
+    X(Equals)        /* r[a] = r[b] == r[c]                              */ \
+    X(NotEquals)     /* r[a] = r[b] != r[c]                              */ \
+    X(Smaller)       /* r[a] = r[b] < r[c]                               */ \
+    X(Greater)       /* r[a] = r[b] > r[c]                               */ \
+    X(Jump)          /* goto c                                           */ \
+    X(JumpIfFalse)   /* if(!r[a]) goto c                                 */ \
+    X(ArgVar)        /* push a reference to variable (b, c)              */ \
+    X(LoadName)      /* r[a] = the variable called names[c] (see         */ \
+                     /* DataHandler::getVar)                             */ \
+    X(StoreName)     /* the variable called names[c] = r[a]              */ \
+    X(ArgName)       /* push a reference to the variable called names[c] */ \
+    X(ArgConst)      /* push a copy of constants[c]                      */ \
+    X(ArgReg)        /* push a copy of r[a]                              */ \
+    X(Call)          /* r[a] = names[c](the last b pushed arguments)     */ \
+    X(TailCall)      /* like Call, but only LeaveScope a times and       */ \
+                     /* Return follow (the result is not used)           */ \
+    X(EnterScope)    /* push a new ::Scope with the slots scopes[c]      */ \
+    X(LeaveScope)    /* pop the current ::Scope                          */ \
+    X(DeclareVar)    /* declare variable (0, c)                          */ \
+    X(Shadowed)      /* fail if variable (b, c) has been declared        */ \
+    X(DeclareFunc)   /* declare function functions[c]                    */ \
+    X(ImplementFunc) /* implement function names[c] declared a scopes up */ \
+                     /* with chunks[b]                                   */ \
+    X(Throw)         /* raise an error with message names[c]             */ \
+    X(Return)        /* leave the current chunk                          */
+
+namespace Bytecode {
+
+    enum class OpCode : std::uint8_t {
+#define NOTENGLISH_OPCODE_ENUM(name) name,
+        NOTENGLISH_OPCODES(NOTENGLISH_OPCODE_ENUM)
+#undef NOTENGLISH_OPCODE_ENUM
+    };
+
+    typedef std::uint16_t Reg;
+
+    struct Instruction {
+        OpCode op;
+        Reg a;
+        std::uint16_t b;
+        std::uint32_t c;
+    };
+
+    /**
+     * A piece of straight-line code: either the main program or the body
+     * of a user-defined function.
+     */
+    struct Chunk {
+        std::vector<Instruction> code;
+        std::size_t registers;
+        // The variables of a function body's ::Scope (in scopes)
+        std::uint32_t scope;
+        // Names of the variables used by instructions (for error messages)
+        std::map<std::size_t, std::uint32_t> symbols;
+
+        Chunk()
+            : code(), registers(0), scope(0), symbols() {}
+    };
+
+    /**
+     * Signature of a function declaration (used by OpCode::DeclareFunc).
+     */
+    struct FunctionInfo {
+        std::string name;
+        std::vector<std::string> args;
+    };
+
+    /**
+     * A fully compiled program. Chunk 0 is the entry point.
+     */
+    struct Program {
+        std::vector<Chunk> chunks;
+        std::vector<Value> constants;
+        std::vector<std::string> names;
+        std::vector<FunctionInfo> functions;
+        // The names of the variables of each ::Scope, by slot
+        std::vector<std::vector<std::string> > scopes;
+    };
+}
+
+#endif // _NOTENGLISH_BYTECODE_H_INCLUDE_GUARD
@@ -0,0 +1,511 @@
+#include "Cache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Bytecode {
+
+    namespace {
+
+        const char magic[8] = { 'N', 'E', 'B', 'Y', 'T', 'E', 'S', '\n' };
+        // Bumped whenever the layout of an image or the meaning of the
+        // bytecode changes (new opcodes are noticed by themselves)
+        const std::uint32_t version = 2;
+        // Written in the byte order of the machine, an image of another
+        // one does not read back as this
+        const std::uint32_t byte_order = 0x01020304;
+
+#define NOTENGLISH_OPCODE_COUNT(name) + 1
+        const std::uint32_t opcode_count = 0 NOTENGLISH_OPCODES(NOTENGLISH_OPCODE_COUNT);
+#undef NOTENGLISH_OPCODE_COUNT
+
+        struct Header {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t byte_order;
+            std::uint32_t opcodes;
+            std::uint32_t instruction_size;
+            std::uint64_t key;
+            // Of the rest of the image
+            std::uint64_t size;
+            std::uint64_t checksum;
+        };
+
+        static_assert(std::is_trivially_copyable<Instruction>::value,
+                      "instructions are copied to and from images as bytes");
+
+        const std::uint64_t fnv_basis = 0xcbf29ce484222325ull;
+        const std::uint64_t fnv_prime = 0x100000001b3ull;
+
+        /**
+         * FNV-1a on whole words (and bytes for the rest), which hashes a
+         * large script in a fraction of the time it takes to lex it.
+         */
+        std::uint64_t hash(const char* data, std::size_t size)
+        {
+            std::uint64_t h = fnv_basis;
+            for(; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t)) {
+                std::uint64_t word;
+                std::memcpy(&word, data, sizeof(word));
+                data += sizeof(word);
+                h = (h ^ word) * fnv_prime;
+                h ^= h >> 32;
+            }
+            for(; size != 0; --size)
+                h = (h ^ static_cast<unsigned char>(*data++)) * fnv_prime;
+            return h;
+        }
+
+        /**
+         * A whole file, mapped into memory if it can be.
+         */
+        class File {
+            void* mapping;
+            std::size_t size;
+            std::string contents;
+        public:
+            File()
+                : mapping(nullptr), size(0), contents() {}
+
+            ~File()
+            {
+                if(mapping)
+                    ::munmap(mapping, size);
+            }
+
+            /**
+             * @return false if the file cannot be read
+             */
+            bool open(const std::string& path)
+            {
+                const int fd = ::open(path.c_str(), O_RDONLY);
+                if(fd < 0)
+                    return false;
+                struct stat st;
+                if(::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+                    void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if(p != MAP_FAILED) {
+                        mapping = p;
+                        size = st.st_size;
+                    }
+                }
+                ::close(fd);
+                if(mapping)
+                    return true;
+                // Not mappable (empty, a pipe, ...), read it at once instead
+                std::ifstream ifs(path.c_str(), std::ios::binary);
+                if(!ifs)
+                    return false;
+                std::ostringstream ss;
+                ss << ifs.rdbuf();
+                contents = ss.str();
+                size = contents.size();
+                return true;
+            }
+
+            const char* data() const
+            {
+                return mapping ? static_cast<const char*>(mapping) : contents.data();
+            }
+
+            std::size_t getSize() const
+            {
+                return size;
+            }
+        };
+
+        class Writer {
+            std::string out;
+        public:
+            Writer()
+                : out() {}
+
+            void bytes(const void* data, std::size_t size)
+            {
+                out.append(static_cast<const char*>(data), size);
+            }
+
+            template<class T>
+            void scalar(T t)
+            {
+                bytes(&t, sizeof(t));
+            }
+
+            void string(const char* data, std::size_t size)
+            {
+                scalar<std::uint32_t>(size);
+                bytes(data, size);
+            }
+
+            void string(const std::string& s)
+            {
+                string(s.data(), s.size());
+            }
+
+            void value(const Value& v)
+            {
+                scalar(v.getType());
+                switch(v.getType()) {
+                    case Value::Type::Number:
+                        scalar(v.number());
+                        break;
+                    case Value::Type::Boolean:
+                        scalar<std::uint8_t>(v.getValue<Value::BoolType>());
+                        break;
+                    case Value::Type::String:
+                        string(v.stringData(), v.stringSize());
+                        break;
+                    case Value::Type::Unkown:
+                        break;
+                }
+            }
+
+            const std::string& get() const
+            {
+                return out;
+            }
+        };
+
+        /**
+         * Reads what a Writer wrote, every read fails once it would go past
+         * the end.
+         */
+        class Reader {
+            const char* pos;
+            const char* end;
+        public:
+            Reader(const char* data, std::size_t size)
+                : pos(data), end(data + size) {}
+
+            bool has(std::size_t size) const
+            {
+                return static_cast<std::size_t>(end - pos) >= size;
+            }
+
+            bool bytes(void* data, std::size_t size)
+            {
+                if(!has(size))
+                    return false;
+                std::memcpy(data, pos, size);
+                pos += size;
+                return true;
+            }
+
+            template<class T>
+            bool scalar(T& t)
+            {
+                return bytes(&t, sizeof(t));
+            }
+
+            bool string(std::string& s)
+            {
+                std::uint32_t size;
+                if(!scalar(size) || !has(size))
+                    return false;
+                s.assign(pos, size);
+                pos += size;
+                return true;
+            }
+
+            bool value(Value& v)
+            {
+                Value::Type type;
+                if(!scalar(type))
+                    return false;
+                switch(type) {
+                    case Value::Type::Number: {
+                        Value::NumberType n;
+                        if(!scalar(n))
+                            return false;
+                        v = Value(n);
+                        return true;
+                    }
+                    case Value::Type::Boolean: {
+                        std::uint8_t b;
+                        if(!scalar(b))
+                            return false;
+                        v = Value(b != 0);
+                        return true;
+                    }
+                    case Value::Type::String: {
+                        std::string s;
+                        if(!string(s))
+                            return false;
+                        v = Value(s);
+                        return true;
+                    }
+                    case Value::Type::Unkown:
+                        v = Value();
+                        return true;
+                }
+                return false;
+            }
+
+            bool done() const
+            {
+                return pos == end;
+            }
+        };
+
+        void write(Writer& w, const Program& program)
+        {
+            w.scalar<std::uint32_t>(program.chunks.size());
+            for(const Chunk& chunk : program.chunks) {
+                w.scalar<std::uint32_t>(chunk.code.size());
+                w.bytes(chunk.code.data(), chunk.code.size() * sizeof(Instruction));
+                w.scalar<std::uint64_t>(chunk.registers);
+                w.scalar(chunk.scope);
+                w.scalar<std::uint32_t>(chunk.symbols.size());
+                for(const auto& symbol : chunk.symbols) {
+                    w.scalar<std::uint64_t>(symbol.first);
+                    w.scalar(symbol.second);
+                }
+            }
+            w.scalar<std::uint32_t>(program.constants.size());
+            for(const Value& v : program.constants)
+                w.value(v);
+            w.scalar<std::uint32_t>(program.names.size());
+            for(const std::string& name : program.names)
+                w.string(name);
+            w.scalar<std::uint32_t>(program.functions.size());
+            for(const FunctionInfo& info : program.functions) {
+                w.string(info.name);
+                w.scalar<std::uint32_t>(info.args.size());
+                for(const std::string& arg : info.args)
+                    w.string(arg);
+            }
+            w.scalar<std::uint32_t>(program.scopes.size());
+            for(const std::vector<std::string>& names : program.scopes) {
+                w.scalar<std::uint32_t>(names.size());
+                for(const std::string& name : names)
+                    w.string(name);
+            }
+        }
+
+        bool read(Reader& r, Program& program)
+        {
+            std::uint32_t count;
+            if(!r.scalar(count))
+                return false;
+            program.chunks.resize(count);
+            for(Chunk& chunk : program.chunks) {
+                std::uint64_t registers;
+                if(!r.scalar(count) || !r.has(count * sizeof(Instruction)))
+                    return false;
+                chunk.code.resize(count);
+                if(!r.bytes(chunk.code.data(), count * sizeof(Instruction))
+                   || !r.scalar(registers) || !r.scalar(chunk.scope) || !r.scalar(count))
+                    return false;
+                chunk.registers = registers;
+                for(std::uint32_t i = 0; i < count; ++i) {
+                    std::uint64_t at;
+                    std::uint32_t name;
+                    if(!r.scalar(at) || !r.scalar(name))
+                        return false;
+                    chunk.symbols.emplace_hint(chunk.symbols.end(), at, name);
+                }
+            }
+            if(!r.scalar(count))
+                return false;
+            program.constants.resize(count);
+            for(Value& v : program.constants) {
+                if(!r.value(v))
+                    return false;
+            }
+            if(!r.scalar(count))
+                return false;
+            program.names.resize(count);
+            for(std::string& name : program.names) {
+                if(!r.string(name))
+                    return false;
+            }
+            if(!r.scalar(count))
+                return false;
+            program.functions.resize(count);
+            for(FunctionInfo& info : program.functions) {
+                if(!r.string(info.name) || !r.scalar(count))
+                    return false;
+                info.args.resize(count);
+                for(std::string& arg : info.args) {
+                    if(!r.string(arg))
+                        return false;
+                }
+            }
+            if(!r.scalar(count))
+                return false;
+            program.scopes.resize(count);
+            for(std::vector<std::string>& names : program.scopes) {
+                if(!r.scalar(count))
+                    return false;
+                names.resize(count);
+                for(std::string& name : names) {
+                    if(!r.string(name))
+                        return false;
+                }
+            }
+            return r.done();
+        }
+
+        /**
+         * Checks that the instructions of \a program only refer to its own
+         * registers, code and tables, which the Bytecode::VM does not check
+         * while running. The slots of variables and the arguments pushed
+         * depend on the state at runtime, they are left alone.
+         */
+        bool check(const Program& program)
+        {
+            // Above any c
+            const std::size_t unchecked =
+                std::size_t(std::numeric_limits<std::uint32_t>::max()) + 1;
+            if(program.chunks.empty())
+                return false;
+            for(std::size_t at = 0; at < program.chunks.size(); ++at) {
+                const Chunk& chunk = program.chunks[at];
+                // The last instruction may not run past the end
+                if(chunk.code.empty() || chunk.code.back().op != OpCode::Return
+                   || chunk.registers > std::numeric_limits<Reg>::max() + std::size_t(1)
+                   || (at != 0 && chunk.scope >= program.scopes.size()))
+                    return false;
+                for(const auto& symbol : chunk.symbols) {
+                    if(symbol.first >= chunk.code.size()
+                       || symbol.second >= program.names.size())
+                        return false;
+                }
+                for(const Instruction& ins : chunk.code) {
+                    // Which operands are registers (a, b, c) and what c is
+                    bool a = false, b = false, c = false;
+                    std::size_t limit = 0;
+                    switch(ins.op) {
+                        case OpCode::LoadConst:
+                            a = true;
+                            // Fall through
+                        case OpCode::ArgConst:
+                            limit = program.constants.size();
+                            break;
+                        case OpCode::Add: case OpCode::Sub: case OpCode::Mul:
+                        case OpCode::Div: case OpCode::And: case OpCode::Or:
+                        case OpCode::Equals: case OpCode::NotEquals:
+                        case OpCode::Smaller: case OpCode::Greater:
+                            c = true;
+                            // Fall through
+                        case OpCode::Neg:
+                            b = true;
+                            // Fall through
+                        case OpCode::LoadVar: case OpCode::StoreVar:
+                        case OpCode::ArgReg:
+                            a = true;
+                            limit = unchecked;
+                            break;
+                        case OpCode::JumpIfFalse:
+                            a = true;
+                            // Fall through
+                        case OpCode::Jump:
+                            limit = chunk.code.size();
+                            break;
+                        case OpCode::LoadName: case OpCode::StoreName:
+                        case OpCode::Call:
+                            a = true;
+                            // Fall through
+                        case OpCode::ArgName: case OpCode::TailCall:
+                        case OpCode::Throw:
+                            limit = program.names.size();
+                            break;
+                        case OpCode::ImplementFunc:
+                            if(ins.b >= program.chunks.size() || ins.b == 0)
+                                return false;
+                            limit = program.names.size();
+                            break;
+                        case OpCode::EnterScope:
+                            limit = program.scopes.size();
+                            break;
+                        case OpCode::DeclareFunc:
+                            limit = program.functions.size();
+                            break;
+                        case OpCode::ArgVar: case OpCode::LeaveScope:
+                        case OpCode::DeclareVar: case OpCode::Shadowed:
+                        case OpCode::Return:
+                            limit = unchecked;
+                            break;
+                        default:
+                            return false;
+                    }
+                    if((a && ins.a >= chunk.registers) || (b && ins.b >= chunk.registers)
+                       || (c ? ins.c >= chunk.registers : ins.c >= limit))
+                        return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    Cache::Cache(const std::string& source, bool optimize)
+        : path(source + "c"), key(0)
+    {
+        File file;
+        if(!file.open(source))
+            throw std::runtime_error("could not open file \"" + source + "\".");
+        key = hash(file.data(), file.getSize());
+        key = (key ^ file.getSize()) * fnv_prime;
+        key = (key ^ (optimize ? 1 : 0)) * fnv_prime;
+    }
+
+    bool Cache::load(Program& program) const
+    {
+        File file;
+        if(!file.open(path) || file.getSize() < sizeof(Header))
+            return false;
+        Header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        const char* payload = file.data() + sizeof(header);
+        const std::size_t size = file.getSize() - sizeof(header);
+        if(std::memcmp(header.magic, magic, sizeof(magic)) != 0
+           || header.version != version || header.byte_order != byte_order
+           || header.opcodes != opcode_count
+           || header.instruction_size != sizeof(Instruction)
+           || header.key != key || header.size != size
+           || header.checksum != hash(payload, size))
+            return false;
+        Program result;
+        Reader r(payload, size);
+        if(!read(r, result) || !check(result))
+            return false;
+        program = std::move(result);
+        return true;
+    }
+
+    void Cache::save(const Program& program) const
+    {
+        Writer w;
+        write(w, program);
+        const std::string& payload = w.get();
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.byte_order = byte_order;
+        header.opcodes = opcode_count;
+        header.instruction_size = sizeof(Instruction);
+        header.key = key;
+        header.size = payload.size();
+        header.checksum = hash(payload.data(), payload.size());
+        // Written aside and renamed, so another run never sees half of it
+        const std::string temp = path + "." + std::to_string(::getpid());
+        {
+            std::ofstream out(temp.c_str(), std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(payload.data(), payload.size());
+            out.close();
+            if(out && std::rename(temp.c_str(), path.c_str()) == 0)
+                return;
+        }
+        std::remove(temp.c_str());
+    }
+}
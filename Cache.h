@@ -0,0 +1,51 @@
+/**
+ * @file Cache.h Keeps the compiled bytecode of a script in a binary image
+ * next to it, so running the script again skips the lexer, parser,
+ * resolver and compiler.
+ */
+#ifndef _NOTENGLISH_CACHE_H_INCLUDE_GUARD
+#define _NOTENGLISH_CACHE_H_INCLUDE_GUARD
+
+#include <cstdint>
+#include <string>
+#include "Bytecode.h"
+
+namespace Bytecode {
+
+    /**
+     * The image of a script is the file name with a "c" appended
+     * ("factorial.ext" is cached in "factorial.extc"). It is keyed by a hash
+     * of the script's contents and of the options its bytecode depends on,
+     * an image of another version of the script is ignored (and replaced).
+     *
+     * Images are written in the byte order of the machine and hold the
+     * instructions as the Bytecode::VM runs them, loading one is a matter
+     * of mapping it and copying its arrays.
+     */
+    class Cache {
+        std::string path;
+        std::uint64_t key;
+    public:
+        /**
+         * Hashes the script \a source (compiled with or without folding
+         * constants, see \a optimize).
+         * @throw std::runtime_error if the script cannot be read
+         */
+        Cache(const std::string& source, bool optimize);
+
+        /**
+         * Loads the image if it exists and belongs to the script, and its
+         * instructions refer only to registers, code and tables it has.
+         * @return false if the script has to be compiled instead
+         */
+        bool load(Program& program) const;
+
+        /**
+         * Writes the image, replacing the old one at once. An image that
+         * cannot be written (say the directory is read-only) is skipped.
+         */
+        void save(const Program& program) const;
+    };
+}
+
+#endif // _NOTENGLISH_CACHE_H_INCLUDE_GUARD
@@ -0,0 +1,346 @@
+#include "Compiler.h"
+#include "Ast.h"
+#include <limits>
+#include <stdexcept>
+
+namespace Bytecode {
+
+    Compiler::Compiler(Program& p)
+        : program(p), chunk(0), top(0), name_index(), dynamic(false)
+    {
+
+    }
+
+    void Compiler::compileProgram(Ast::Block& root)
+    {
+        program.chunks.assign(1, Chunk());
+        program.scopes.clear();
+        chunk = 0;
+        top = 0;
+        dynamic = false;
+        root.compile(*this, allocate());
+        emit(OpCode::Return);
+        if(dynamic)
+            return;
+        for(std::size_t at = 1; at < program.chunks.size(); ++at)
+            markTailCalls(at);
+    }
+
+    std::uint16_t Compiler::compileFunction(Ast::Block& body)
+    {
+        if(program.chunks.size() > std::numeric_limits<std::uint16_t>::max())
+            throw std::runtime_error("too many functions for the bytecode compiler");
+        const std::size_t saved_chunk = chunk;
+        const Reg saved_top = top;
+        program.chunks.push_back(Chunk());
+        chunk = program.chunks.size() - 1;
+        top = 0;
+        program.chunks[chunk].scope = scope(body.getNames());
+        body.compileStatements(*this);
+        emit(OpCode::Return);
+        const std::uint16_t index = chunk;
+        chunk = saved_chunk;
+        top = saved_top;
+        return index;
+    }
+
+    void Compiler::markTailCalls(std::size_t at)
+    {
+        std::vector<Instruction>& code = program.chunks[at].code;
+        for(std::size_t i = 0; i < code.size(); ++i) {
+            if(code[i].op != OpCode::Call)
+                continue;
+            // Follow the code after the call, giving up on anything that
+            // could still use the function's scope (bounded in case of a
+            // loop of jumps)
+            std::size_t after = i + 1;
+            std::uint16_t leaves = 0;
+            for(std::size_t steps = 0; steps < code.size() && after < code.size(); ++steps) {
+                const Instruction& next = code[after];
+                if(next.op == OpCode::LeaveScope) {
+                    ++leaves;
+                    ++after;
+                } else if(next.op == OpCode::Jump) {
+                    after = next.c;
+                } else {
+                    if(next.op == OpCode::Return) {
+                        code[i].op = OpCode::TailCall;
+                        code[i].a = leaves;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    Reg Compiler::allocate()
+    {
+        if(top == std::numeric_limits<Reg>::max())
+            throw std::runtime_error("expression too complex for the bytecode compiler");
+        Reg r = top++;
+        Chunk& current = program.chunks[chunk];
+        if(current.registers < top)
+            current.registers = top;
+        return r;
+    }
+
+    void Compiler::release(Reg r)
+    {
+        top = r;
+    }
+
+    std::size_t Compiler::emit(OpCode op, Reg a, std::uint16_t b, std::uint32_t c)
+    {
+        std::vector<Instruction>& code = program.chunks[chunk].code;
+        code.push_back(Instruction{op, a, b, c});
+        return code.size() - 1;
+    }
+
+    void Compiler::emitVar(OpCode op, Reg a, const Binding& b, const std::string& var)
+    {
+        if(!b.resolved()) {
+            switch(op) {
+                case OpCode::LoadVar: op = OpCode::LoadName; break;
+                case OpCode::StoreVar: op = OpCode::StoreName; break;
+                case OpCode::ArgVar: op = OpCode::ArgName; break;
+                default:
+                    throw std::runtime_error("variable " + var + " is not in a scope");
+            }
+            // Only functions see the variables of callers
+            if(chunk != 0)
+                dynamic = true;
+            emit(op, a, 0, name(var));
+            return;
+        }
+        if(b.depth > std::numeric_limits<std::uint16_t>::max()
+           || b.slot > std::numeric_limits<std::uint32_t>::max())
+            throw std::runtime_error("scopes nested too deeply for the bytecode compiler");
+        program.chunks[chunk].symbols[emit(op, a, b.depth, b.slot)] = name(var);
+    }
+
+    void Compiler::patch(std::size_t at)
+    {
+        program.chunks[chunk].code[at].c = here();
+    }
+
+    std::size_t Compiler::here() const
+    {
+        return program.chunks[chunk].code.size();
+    }
+
+    std::uint32_t Compiler::scope(const SlotNames& names)
+    {
+        program.scopes.push_back(names);
+        return program.scopes.size() - 1;
+    }
+
+    std::uint32_t Compiler::constant(const Value& value)
+    {
+        program.constants.push_back(value);
+        return program.constants.size() - 1;
+    }
+
+    std::uint32_t Compiler::name(const std::string& n)
+    {
+        auto it = name_index.find(n);
+        if(it != name_index.end())
+            return it->second;
+        program.names.push_back(n);
+        return name_index[n] = program.names.size() - 1;
+    }
+
+    std::uint32_t Compiler::function(const FunctionInfo& info)
+    {
+        program.functions.push_back(info);
+        return program.functions.size() - 1;
+    }
+}
+
+// Lowering of the Ast nodes
+using Bytecode::Compiler;
+using Bytecode::OpCode;
+using Bytecode::Reg;
+
+namespace Ast {
+
+    void Node::compileArg(Compiler& c)
+    {
+        Reg r = c.allocate();
+        compile(c, r);
+        c.emit(OpCode::ArgReg, r);
+        c.release(r);
+    }
+
+    void Block::compile(Compiler& c, Reg dst)
+    {
+        c.emit(OpCode::EnterScope, 0, 0, c.scope(names));
+        compileStatements(c);
+        c.emit(OpCode::LeaveScope);
+    }
+
+    void Block::compileStatements(Compiler& c)
+    {
+        Reg scratch = c.allocate();
+        for(auto& n : stmnts)
+            n->compile(c, scratch);
+        c.release(scratch);
+    }
+
+    static OpCode arithmeticOp(char op)
+    {
+        switch(op) {
+            case '+': return OpCode::Add;
+            case '-': return OpCode::Sub;
+            case '*': return OpCode::Mul;
+            case '/': return OpCode::Div;
+            default:
+                throw std::runtime_error(std::string("Invalid operator ") + op);
+        }
+    }
+
+    void Expression::compile(Compiler& c, Reg dst)
+    {
+        left->compile(c, dst);
+        if(!right)
+            return;
+        Reg r = c.allocate();
+        right->compile(c, r);
+        c.emit(arithmeticOp(op), dst, dst, r);
+        c.release(r);
+    }
+
+    void Expression::compileArg(Compiler& c)
+    {
+        // A lone operand is passed as is (by reference)
+        if(!right)
+            left->compileArg(c);
+        else
+            Node::compileArg(c);
+    }
+
+    void UnaryOp::compile(Compiler& c, Reg dst)
+    {
+        sub->compile(c, dst);
+        if(op == '-')
+            c.emit(OpCode::Neg, dst, dst);
+    }
+
+    void UnaryOp::compileArg(Compiler& c)
+    {
+        if(op == '-')
+            Node::compileArg(c);
+        else
+            sub->compileArg(c);
+    }
+
+    void Condition::compile(Compiler& c, Reg dst)
+    {
+        OpCode code;
+        switch(op) {
+            case '&': code = OpCode::And; break;
+            case '|': code = OpCode::Or; break;
+            case '=': code = OpCode::Equals; break;
+            case '!': code = OpCode::NotEquals; break;
+            case '<': code = OpCode::Smaller; break;
+            case '>': code = OpCode::Greater; break;
+            default:
+                throw std::runtime_error(std::string("Invalid operator ") + op);
+        }
+        left->compile(c, dst);
+        Reg r = c.allocate();
+        right->compile(c, r);
+        c.emit(code, dst, dst, r);
+        c.release(r);
+    }
+
+    void Literal::compile(Compiler& c, Reg dst)
+    {
+        c.emit(OpCode::LoadConst, dst, 0, c.constant(val));
+    }
+
+    void Literal::compileArg(Compiler& c)
+    {
+        c.emit(OpCode::ArgConst, 0, 0, c.constant(val));
+    }
+
+    void FunctionCall::compile(Compiler& c, Reg dst)
+    {
+        if(args.size() > std::numeric_limits<std::uint16_t>::max())
+            throw std::runtime_error("too many arguments in call to " + name);
+        for(auto& arg : args)
+            arg->compileArg(c);
+        c.emit(OpCode::Call, dst, args.size(), c.name(name));
+    }
+
+    void Assignment::compile(Compiler& c, Reg dst)
+    {
+        Reg r = c.allocate();
+        // A variable of a caller has to exist before the value is computed
+        if(!binding.resolved())
+            c.emitVar(OpCode::LoadVar, r, binding, name);
+        value->compile(c, r);
+        c.emitVar(OpCode::StoreVar, r, binding, name);
+        c.release(r);
+    }
+
+    void VarDeclaration::compile(Compiler& c, Reg dst)
+    {
+        if(shadowed.resolved())
+            c.emitVar(OpCode::Shadowed, 0, shadowed, name);
+        c.emitVar(OpCode::DeclareVar, 0, binding, name);
+    }
+
+    void FuncDeclaration::compile(Compiler& c, Reg dst)
+    {
+        c.emit(OpCode::DeclareFunc, 0, 0, c.function({name, args}));
+    }
+
+    void FuncImpl::compile(Compiler& c, Reg dst)
+    {
+        if(home < 0) {
+            c.emit(OpCode::Throw, 0, 0, c.name("Undefined function " + name + " used."));
+            return;
+        }
+        std::uint16_t chunk = c.compileFunction(*body);
+        c.emit(OpCode::ImplementFunc, home, chunk, c.name(name));
+    }
+
+    void VarNode::compile(Compiler& c, Reg dst)
+    {
+        c.emitVar(OpCode::LoadVar, dst, binding, name);
+    }
+
+    void VarNode::compileArg(Compiler& c)
+    {
+        c.emitVar(OpCode::ArgVar, 0, binding, name);
+    }
+
+    void IfStatement::compile(Compiler& c, Reg dst)
+    {
+        Reg r = c.allocate();
+        condition->compile(c, r);
+        std::size_t to_else = c.emit(OpCode::JumpIfFalse, r);
+        c.release(r);
+        body_if->compile(c, dst);
+        if(body_else) {
+            std::size_t to_end = c.emit(OpCode::Jump);
+            c.patch(to_else);
+            body_else->compile(c, dst);
+            c.patch(to_end);
+        } else {
+            c.patch(to_else);
+        }
+    }
+
+    void WhileStatement::compile(Compiler& c, Reg dst)
+    {
+        std::size_t loop = c.here();
+        Reg r = c.allocate();
+        condition->compile(c, r);
+        std::size_t to_end = c.emit(OpCode::JumpIfFalse, r);
+        c.release(r);
+        body->compile(c, dst);
+        c.emit(OpCode::Jump, 0, 0, loop);
+        c.patch(to_end);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef _NOTENGLISH_COMPILER_H_INCLUDE_GUARD
+#define _NOTENGLISH_COMPILER_H_INCLUDE_GUARD
+
+#include <map>
+#include "Bytecode.h"
+#include "DataHandler.h"
+
+namespace Ast {
+    class Block;
+}
+
+namespace Bytecode {
+
+    /**
+     * Lowers an Ast::Block into a Bytecode::Program. The actual lowering of
+     * each node is done by Ast::Node::compile, the ::Compiler only keeps
+     * track of the chunk being written and of the registers in use.
+     */
+    class Compiler {
+        Program& program;
+        std::size_t chunk;
+        Reg top;
+        std::map<std::string, std::uint32_t> name_index;
+        // Whether a function looks up a name among the variables of its
+        // callers, whose scopes a tail call would take away
+        bool dynamic;
+
+        /**
+         * Turns the calls of chunk \a at after which the function returns
+         * into OpCode::TailCall.
+         */
+        void markTailCalls(std::size_t at);
+    public:
+        Compiler(Program& p);
+
+        /**
+         * Compiles the main program into chunk 0.
+         */
+        void compileProgram(Ast::Block& root);
+
+        /**
+         * Compiles the body of a user-defined function into a new chunk.
+         * @return the index of the chunk
+         */
+        std::uint16_t compileFunction(Ast::Block& body);
+
+        /**
+         * Allocates a register. Registers are handed out (and released) in
+         * stack order.
+         */
+        Reg allocate();
+        void release(Reg r);
+
+        std::size_t emit(OpCode op, Reg a = 0, std::uint16_t b = 0, std::uint32_t c = 0);
+
+        /**
+         * Emits an instruction accessing the variable \a b, or one looking
+         * the variable up by its name \a var if it could not be resolved
+         * (OpCode::LoadName for OpCode::LoadVar and so on).
+         */
+        void emitVar(OpCode op, Reg a, const Binding& b, const std::string& var);
+
+        /**
+         * Points the jump at \a at to the next instruction to be emitted.
+         */
+        void patch(std::size_t at);
+
+        std::size_t here() const;
+
+        /**
+         * @return the index of a ::Scope with the variables \a names
+         */
+        std::uint32_t scope(const SlotNames& names);
+        std::uint32_t constant(const Value& value);
+        std::uint32_t name(const std::string& n);
+        std::uint32_t function(const FunctionInfo& info);
+    };
+}
+
+#endif // _NOTENGLISH_COMPILER_H_INCLUDE_GUARD
@@ -2,197 +2,207 @@
 #define _DATAHANDLER_GUARD
 #include "DataHandler.h"
 #include <iostream>
-
-
-void Scope::addVar(const std::string& name)
-{
-    var_table.insert(std::make_pair(name, VarPtr(new Variable)));
+#include <stdexcept>
+
+namespace {
+
+    // The system functions, the same for all programs
+    const std::map<std::string, SysFunc>& sysFuncs()
+    {
+        static const std::map<std::string, SysFunc> table = {
+            { "getInput", sys::get_input },
+            { "ask", sys::get_input },
+            { "Display", sys::display },
+            { "Show", sys::display },
+            { "Output", sys::display },
+            { "Echo", sys::display },
+            { "Write", sys::display },
+            { "Print", sys::display },
+            { "toNumber", sys::to_number },
+            { "toString", sys::to_string }
+        };
+        return table;
+    }
 }
 
-void Scope::addFunc(DataHandler* data, const std::string& name, const std::vector<std::string>& args)
+DataHandler::DataHandler()
+    : slots(), scopes(), funcs(), constant_names(), output(&Output::standard()),
+      input(sys::standard_input), epoch(1), deferred(nullptr), deferred_args(),
+      dynamic_names(false)
 {
-    usr_func_table.insert(std::pair<std::string, Function>(
-        name, Function(data, args)
-    ));
+    slots.reserve(1024);
+    scopes.reserve(256);
+    scopes.push_back(Scope(0, 0, &constant_names));
+    addConstants();
 }
 
-void Scope::delVar(const std::string& name)
+void DataHandler::addConstants()
 {
-    var_table.erase(name);
+    addConstant("newline", make_variable(std::string("\n")));
+    addConstant("zero", make_variable(0.0));
+    addConstant("one", make_variable(1.0));
+    addConstant("two", make_variable(2.0));
+    addConstant("three", make_variable(3.0));
+    addConstant("four", make_variable(4.0));
+    addConstant("five", make_variable(5.0));
+    addConstant("six", make_variable(6.0));
+    addConstant("seven", make_variable(7.0));
+    addConstant("eight", make_variable(8.0));
+    addConstant("nine", make_variable(9.0));
 }
 
-void Scope::delFunc(const std::string& name)
+void DataHandler::reset()
 {
-    usr_func_table.erase(name);
+    // Call sites that found a function have to look again
+    funcs.clear();
+    ++epoch;
+    deferred = nullptr;
+    deferred_args.clear();
+    dynamic_names = false;
+    scopes.erase(scopes.begin() + 1, scopes.end());
+    slots.clear();
+    constant_names.clear();
+    addConstants();
 }
 
-bool Scope::varExists(const std::string& name)
+void DataHandler::setIO(Output::Stream& out, sys::Input in)
 {
-    return var_table.find(name) != var_table.end();
+    output = &out;
+    input = std::move(in);
 }
 
-bool Scope::funcExists(const std::string& name)
+void DataHandler::addConstant(const std::string& name, const VarPtr& value)
 {
-    return usr_func_table.find(name) != usr_func_table.end();
+    // The constants are the only variables that are known before resolving,
+    // they are added while the bottom scope is the only one
+    constant_names.push_back(name);
+    slots.push_back(value);
 }
 
-VarPtr Scope::call(const std::string& name, arg_t& args) {
-
-    auto it = usr_func_table.find(name);
-    if(it != usr_func_table.end()) {
-        VarPtr result = it->second.call(args);
-        // for(const std::string& name : fn_args)
-        //    delVar(name); // Remove arguments
-        return result;
-    }
-    std::cerr << "undefined function \"" << name << "\" used" << std::endl;
-    return VarPtr();
-}
-
-VarPtr& Scope::getVar(const std::string& name)
+void DataHandler::addFunc(const std::string& name,
+        const std::vector<std::string>& args)
 {
-    std::map<std::string, VarPtr>::iterator it = var_table.find(name);
-    if(it == var_table.end())
-        std::cerr << "undefined variable \"" << name << "\" used" << std::endl;
-    return it->second;
+    funcs.emplace_back(name, Function(this, name, args, scopes.size() - 1));
+    ++epoch;
 }
 
-Function& Scope::getFunc(const std::string& name)
+bool DataHandler::funcExists(const std::string& name)
 {
-    auto it = usr_func_table.find(name);
-    if (it == usr_func_table.end())
-        std::cerr << "undefined function \"" << name << "\" used" << std::endl;
-    return it->second;
+    return findSysFunc(name) || findFunc(name);
 }
 
-void Scope::setRef(const std::string& name, const VarPtr& value)
+Value DataHandler::call(const std::string& name, arg_t& args)
 {
-    var_table[name] = value;
+    if(SysFunc func = findSysFunc(name))
+        return func(*this, args);
+    if(Function* func = findFunc(name))
+        return func->call(args);
+    throw std::runtime_error("use of nonexistant function " + name);
 }
 
-void Scope::set(const std::string& name, const VarPtr& value)
+SysFunc DataHandler::findSysFunc(const std::string& name)
 {
-    *var_table[name] = *value;
-}
-
-DataHandler::DataHandler()
-    : scopes()
-{
-    scopes.push_front(Scope());
-    Scope& front = scopes.front();
-    front.setRef("newline", make_variable(std::string("\n")));
-    front.setRef("zero", make_variable(0.0));
-    front.setRef("one", make_variable(1.0));
-    front.setRef("two", make_variable(2.0));
-    front.setRef("three", make_variable(3.0));
-    front.setRef("four", make_variable(4.0));
-    front.setRef("five", make_variable(5.0));
-    front.setRef("six", make_variable(6.0));
-    front.setRef("seven", make_variable(7.0));
-    front.setRef("eight", make_variable(8.0));
-    front.setRef("nine", make_variable(9.0));
-    // Initialize system functions
-    func_table["getInput"] = sys::get_input;
-    func_table["ask"] = sys::get_input;
-    func_table["Display"] = sys::display;
-    func_table["Show"] = sys::display;
-    func_table["Output"] = sys::display;
-    func_table["Echo"] = sys::display;
-    func_table["Write"] = sys::display;
-    func_table["Print"] = sys::display;
-    func_table["toNumber"] = sys::to_number;
-    func_table["toString"] = sys::to_string;
-}
-
-void DataHandler::addVar(const std::string& name)
-{
-    scopes.front().addVar(name);
+    const std::map<std::string, SysFunc>& table = sysFuncs();
+    auto it = table.find(name);
+    if(it == table.end())
+        return nullptr;
+    return it->second;
 }
 
-void DataHandler::addFunc(const std::string& name,
-        const std::vector<std::string>& args)
+Function* DataHandler::findFunc(const std::string& name)
 {
-    scopes.front().addFunc(this, name, args);
+    // The innermost function first
+    for(auto it = funcs.rbegin(); it != funcs.rend(); ++it) {
+        if(it->first == name)
+            return &it->second;
+    }
+    return nullptr;
 }
 
-void DataHandler::delVar(const std::string& name)
+bool DataHandler::lookup(const std::string& name, CallSite& site)
 {
-    scopes.front().delVar(name);
+    if(site.sys || (site.func && site.epoch == epoch))
+        return true;
+    site.epoch = epoch;
+    site.sys = findSysFunc(name);
+    site.func = site.sys ? nullptr : findFunc(name);
+    return site.sys || site.func;
 }
 
-void DataHandler::delFunc(const std::string& name)
+bool DataHandler::deferCall(Function* func, arg_t& args, int scopes)
 {
-    scopes.front().delFunc(name);
+    if(dynamic_names || holdsFuncs(scopes))
+        return false;
+    deferred = func;
+    deferred_args.swap(args);
+    return true;
 }
 
-bool DataHandler::varExists(const std::string& name)
+Function* DataHandler::takeDeferred(arg_t& args)
 {
-    for(Scope& scope : scopes) {
-        if(scope.varExists(name))
-            return true;
-    }
-    return false;
+    Function* func = deferred;
+    deferred = nullptr;
+    args.swap(deferred_args);
+    deferred_args.clear();
+    return func;
 }
 
-bool DataHandler::funcExists(const std::string& name)
+bool DataHandler::holdsFuncs(int count) const
 {
-    if(func_table.find(name) != func_table.end())
-        return true;
-    for(Scope& scope : scopes) {
-        if(scope.funcExists(name))
-            return true;
+    // The functions are ordered by their scope, like the scopes themselves
+    ScopeIndex scope = scopes.size() - 1;
+    for(; count > 0; --count, scope = scopes[scope].parent) {
+        for(auto it = funcs.rbegin(); it != funcs.rend() && it->second.getHome() >= scope; ++it) {
+            if(it->second.getHome() == scope)
+                return true;
+        }
     }
     return false;
 }
 
-VarPtr DataHandler::call(const std::string& name, arg_t& args)
-{
-    auto it = func_table.find(name);
-    if(it != func_table.end())
-        return (*it->second)(args);
-    for(Scope& scope : scopes) {
-        if(scope.funcExists(name))
-            return scope.call(name, args);
-    }
-}
-
-void DataHandler::setRef(const std::string& name, const VarPtr& value)
-{
-    return scopes.front().setRef(name, value);
-}
-
-void DataHandler::set(const std::string& name, const VarPtr& value)
+VarPtr& DataHandler::getVar(const std::string& name)
 {
-    for(Scope& scope : scopes) {
-        if(scope.varExists(name))
-            return scope.set(name, value);
+    // The scopes are on the stack in the order of the calls
+    for(ScopeIndex scope = scopes.size(); scope-- > 0;) {
+        const SlotNames& names = *scopes[scope].names;
+        for(std::size_t slot = 0; slot < names.size(); ++slot) {
+            VarPtr& var = slots[scopes[scope].base + slot];
+            if(var && names[slot] == name)
+                return var;
+        }
     }
+    throw std::runtime_error("Undefined variable " + name + " used.");
 }
 
-VarPtr& DataHandler::getVar(const std::string& name)
+void DataHandler::addScope(const SlotNames& names)
 {
-    for(Scope& scope : scopes) {
-        if(scope.varExists(name))
-            return scope.getVar(name);
-    }
+    addScope(names, scopes.size() - 1);
 }
 
-Function& DataHandler::getFunc(const std::string& name)
+void DataHandler::addScope(const SlotNames& names, ScopeIndex parent)
 {
-    for(Scope& scope : scopes) {
-        if(scope.funcExists(name))
-            return scope.getFunc(name);
-    }
+    scopes.push_back(Scope(slots.size(), parent, &names));
+    slots.resize(slots.size() + names.size());
 }
 
-void DataHandler::addScope()
+void DataHandler::growScope(std::size_t size)
 {
-    scopes.push_front(Scope());
+    if(scopes.back().base + size > slots.size())
+        slots.resize(scopes.back().base + size);
 }
 
 void DataHandler::popScope()
 {
-    scopes.pop_front();
+    // The functions of the scope are gone with it
+    const ScopeIndex scope = scopes.size() - 1;
+    if(!funcs.empty() && funcs.back().second.getHome() == scope) {
+        do {
+            funcs.pop_back();
+        } while(!funcs.empty() && funcs.back().second.getHome() == scope);
+        ++epoch;
+    }
+    slots.resize(scopes.back().base);
+    scopes.pop_back();
 }
 
 #endif
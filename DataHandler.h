@@ -3,67 +3,269 @@
 #include <string>
 #include <map>
 #include <deque>
+#include <vector>
 #include <typeinfo>
 #include "Variable.h"
+#include "Pool.h"
 #include "SysFunctions.h"
 #include "Function.h"
+#include "Output.h"
+
+class DataHandler;
 
 // Useful typedef
-typedef VarPtr (*SysFunc)(arg_t&);
+typedef Value (*SysFunc)(DataHandler&, arg_t&);
 
-template<class T>
-VarPtr make_variable(const T& v)
+/**
+ * Makes a new ::Variable cell, drawn from the ::Pool.
+ */
+inline VarPtr make_variable(const Value& v)
 {
-    return VarPtr(new Variable(v));
+    return std::allocate_shared<Variable>(PoolAllocator<Variable>(), v);
 }
 
-class DataHandler;
+/**
+ * The location of a variable as determined by the ::Resolver: the number of
+ * scopes to walk up (following Scope::parent) and the slot in that scope.
+ * A negative depth means the name could not be resolved.
+ */
+struct Binding {
+    int depth;
+    std::size_t slot;
+
+    Binding()
+        : depth(-1), slot(0) {}
+
+    Binding(int d, std::size_t s)
+        : depth(d), slot(s) {}
+
+    bool resolved() const
+    {
+        return depth >= 0;
+    }
+};
 
 /**
- * Represents a scope of the program. A ::Scope contains variales and functions.
- * All blocks have their own scope.
+ * The function a call site refers to, cached by DataHandler::lookup. A
+ * user-defined function is only valid as long as the epoch it was found in
+ * (system functions never change).
  */
-class Scope {
-    std::map<std::string, VarPtr> var_table;
-    std::map<std::string, Function> usr_func_table;
-public:
-    Scope() = default;
-    void addVar(const std::string& name);
-    void addFunc(DataHandler* data, const std::string& name, const std::vector<std::string>& args);
-    void delVar(const std::string& name);
-    void delFunc(const std::string& name);
-    bool varExists(const std::string& name);
-    bool funcExists(const std::string& name);
-    VarPtr call(const std::string& name, arg_t& args);
-    void setRef(const std::string& name, const VarPtr& value);
-    void set(const std::string& name, const VarPtr& value);
-    VarPtr& getVar(const std::string& name);
-    Function& getFunc(const std::string& name);
+struct CallSite {
+    std::size_t epoch;
+    SysFunc sys;
+    Function* func;
+
+    CallSite()
+        : epoch(0), sys(nullptr), func(nullptr) {}
 };
 
 /**
- * Operates as the current ::Scope. It could be seen as a sort of 
- *  composite. The underlying data structure is a deque, which is essentially
- *  used as an iterable stack.
+ * The names of the variables of a ::Scope, by slot.
+ */
+typedef std::vector<std::string> SlotNames;
+
+/**
+ * Represents a scope of the program: a window of the slot stack of the
+ * ::DataHandler. All blocks have their own scope. Variables live in a fixed
+ * number of slots (as computed by the ::Resolver), an empty slot is a
+ * variable that has not been declared (yet).
+ * The parent of a ::Scope is the lexically enclosing one, for the body of a
+ * user-defined function that is the ::Scope the function was declared in.
+ * Scopes are known by their ::ScopeIndex.
+ */
+struct Scope {
+    // The first slot of the scope on the slot stack
+    std::size_t base;
+    ScopeIndex parent;
+    // Owned by the block (or chunk) the scope is made for
+    const SlotNames* names;
+
+    Scope(std::size_t b, ScopeIndex p, const SlotNames* n)
+        : base(b), parent(p), names(n) {}
+};
+
+/**
+ * Operates as the current ::Scope. All variables of all scopes are kept on
+ * one contiguous stack of slots, so entering and leaving a ::Scope only
+ * moves the top of that stack. User-defined functions are kept on a stack
+ * of their own and go with the ::Scope declaring them.
+ * The bottom ::Scope holds the built-in constants (see getConstantNames).
  * @see ::Scope
  */
 class DataHandler {
-    std::deque<Scope> scopes;
-    std::map<std::string, SysFunc> func_table;
+    std::vector<VarPtr> slots;
+    std::vector<Scope> scopes;
+    // Never reallocated, so that a Function* stays valid while it exists
+    std::deque< std::pair<std::string, Function> > funcs;
+    std::vector<std::string> constant_names;
+    // Where the output of the program goes and its input comes from
+    Output::Stream* output;
+    sys::Input input;
+    // Changes whenever the user-defined functions in reach change
+    std::size_t epoch;
+    // A tail call waiting for the calling function to return
+    Function* deferred;
+    arg_t deferred_args;
+    // Whether functions look up names in the scopes of their callers
+    bool dynamic_names;
+
+    void addConstant(const std::string& name, const VarPtr& value);
+    void addConstants();
 public:
     DataHandler();
-    void addVar(const std::string& name);
+
+    /**
+     * Forgets the variables, scopes and functions of the program that ran,
+     * the built-in constants get their initial values back. The memory of
+     * the stacks is kept for the next program.
+     */
+    void reset();
+
+    /**
+     * Sends the output of the program to \a out (which has to outlive the
+     * ::DataHandler) and reads its input with \a in, instead of the
+     * standard output and input.
+     */
+    void setIO(Output::Stream& out, sys::Input in);
+
+    Output::Stream& getOutput()
+    {
+        return *output;
+    }
+
+    /**
+     * Reads a line of the input of the program.
+     * @return false at the end of it
+     */
+    bool readInput(std::string& line)
+    {
+        return input(line);
+    }
+
+    /**
+     * Declares a function in the current ::Scope.
+     */
     void addFunc(const std::string& name, const std::vector<std::string>& args);
-    void delVar(const std::string& name);
-    void delFunc(const std::string& name);
-    bool varExists(const std::string& name);
     bool funcExists(const std::string& name);
-    VarPtr call(const std::string& name, arg_t& args);
-    void setRef(const std::string& name, const VarPtr& value);
-    void set(const std::string& name, const VarPtr& value);
+    Value call(const std::string& name, arg_t& args);
+    /**
+     * @return the system function called \a name or nullptr
+     */
+    SysFunc findSysFunc(const std::string& name);
+    /**
+     * @return the user-defined function called \a name or nullptr
+     */
+    Function* findFunc(const std::string& name);
+    /**
+     * Finds the function called \a name, unless \a site still refers to it.
+     * @return whether there is such a function
+     */
+    bool lookup(const std::string& name, CallSite& site);
+    /**
+     * Calls the function found by DataHandler::lookup.
+     */
+    Value call(const CallSite& site, arg_t& args)
+    {
+        if(site.sys)
+            return site.sys(*this, args);
+        return site.func->call(args);
+    }
+
+    /**
+     * Defers a tail call made \a scopes scopes deep into the body of a
+     * user-defined function, Function::call makes it once the body is done.
+     * @return false if the call has to be made now, because a function in
+     *  the scopes to be left could be needed
+     */
+    bool deferCall(Function* func, arg_t& args, int scopes);
+    /**
+     * Takes the deferred tail call, if any.
+     * @return the function to call, nullptr if there is none
+     */
+    Function* takeDeferred(arg_t& args);
+
+    /**
+     * @return the names of the built-in constants, in slot order
+     */
+    const std::vector<std::string>& getConstantNames() const
+    {
+        return constant_names;
+    }
+
+    /**
+     * @return the initial value of the built-in constant in \a slot
+     */
+    const Value& getConstant(std::size_t slot)
+    {
+        // The bottom scope starts at the bottom of the stack
+        return *slots[slot];
+    }
+
+    /**
+     * @return the ::Scope \a depth levels up from the current one
+     */
+    ScopeIndex getScope(int depth) const
+    {
+        ScopeIndex scope = scopes.size() - 1;
+        while(depth-- > 0)
+            scope = scopes[scope].parent;
+        return scope;
+    }
+
+    /**
+     * @return whether one of the \a count innermost scopes (following
+     *  Scope::parent) holds user-defined functions
+     */
+    bool holdsFuncs(int count) const;
+
+    /**
+     * Finds a variable by its name in all scopes on the stack, the
+     * innermost first, so a function sees the variables of its callers.
+     * This is the way names were found before they were bound (see
+     * ::Resolver), it is left for the names a function uses but does not
+     * see lexically.
+     * @throw std::runtime_error if no such variable has been declared
+     */
     VarPtr& getVar(const std::string& name);
-    Function& getFunc(const std::string& name);
-    void addScope();
+
+    /**
+     * Notes whether names are looked up in the scopes of the callers (see
+     * DataHandler::getVar), the scopes of a function making a tail call
+     * are kept then.
+     */
+    void setDynamicNames(bool dynamic)
+    {
+        dynamic_names = dynamic;
+    }
+
+    VarPtr& getVar(int depth, std::size_t slot)
+    {
+        return slots[scopes[getScope(depth)].base + slot];
+    }
+
+    /**
+     * The reference is only valid until the next ::Scope is added.
+     */
+    VarPtr& getVar(const Binding& b)
+    {
+        return getVar(b.depth, b.slot);
+    }
+
+    /**
+     * Adds a ::Scope with a slot for each of \a names (which has to outlive
+     * it) on top of the current one.
+     */
+    void addScope(const SlotNames& names);
+    /**
+     * Adds a ::Scope with an explicit parent (used for function calls).
+     */
+    void addScope(const SlotNames& names, ScopeIndex parent);
+    /**
+     * Grows the current ::Scope, which has to be the top one, to \a size
+     * slots (for a program that is resolved while it runs, its names have
+     * grown to as many).
+     */
+    void growScope(std::size_t size);
     void popScope();
 };
 #endif
@@ -1,22 +1,86 @@
 #include "Function.h"
 #include "Ast.h"
+#include <stdexcept>
+#include <pthread.h>
 
-Function::Function(DataHandler* data, const std::vector<std::string>& args)
-    : data(data), args(args), body(nullptr)
+namespace {
+
+    /**
+     * Calls on the syntax tree that are no tail calls run on the host
+     * stack, they stop this far (in bytes) from its end. Enough is left for
+     * the nodes between two calls and for unwinding.
+     */
+    const std::size_t stack_reserve = 256 * 1024;
+
+    /**
+     * @return the lowest address calls of the calling thread may reach,
+     *  nullptr if the stack of the thread is not known
+     */
+    const char* findStackLimit()
+    {
+        pthread_attr_t attr;
+        if(pthread_getattr_np(pthread_self(), &attr) != 0)
+            return nullptr;
+        void* low = nullptr;
+        std::size_t size = 0;
+        const bool known = pthread_attr_getstack(&attr, &low, &size) == 0;
+        pthread_attr_destroy(&attr);
+        if(!known || size <= stack_reserve)
+            return nullptr;
+        // The stack grows down to low
+        return static_cast<const char*>(low) + stack_reserve;
+    }
+}
+
+Function::Function(DataHandler* data, const std::string& name,
+                   const std::vector<std::string>& args, ScopeIndex home)
+    : data(data), name(name), args(args), home(home), body(nullptr), code(nullptr)
 {
 
 }
 
+void Function::checkImplemented() const
+{
+    if(!body)
+        throw std::runtime_error("Undefined function " + name + " used.");
+}
+
 void Function::setBody(Ast::Block* b)
 {
     body = b;
 }
 
-VarPtr Function::call(arg_t& arg_vals)
+void Function::setCode(const Bytecode::Chunk* c)
 {
-    body->premakeScope();
-    for(size_t i = 0; i < args.size(); ++i) {
-        data->setRef(args[i], arg_vals[i]);
-    }
-    return body->execute();
+    code = c;
+}
+
+Value Function::call(arg_t& arg_vals)
+{
+    static thread_local const char* const stack_limit = findStackLimit();
+    const char here = 0;
+    if(&here < stack_limit)
+        throw std::runtime_error("call depth exceeded");
+    // Tail calls are made here, after the body of their caller is done,
+    // instead of on top of it
+    Function* func = this;
+    arg_t tail_args;
+    arg_t* vals = &arg_vals;
+    checkImplemented();
+    Profiler::Call profile(body->getFunction());
+    do {
+        func->body->premakeScope(func->home);
+        // The arguments occupy the first slots of the function's scope
+        for(size_t i = 0; i < func->args.size() && i < vals->size(); ++i) {
+            data->getVar(0, i) = (*vals)[i];
+        }
+        func->body->execute();
+        vals = &tail_args;
+        func = data->takeDeferred(tail_args);
+        if(func) {
+            func->checkImplemented();
+            profile.replace(func->body->getFunction());
+        }
+    } while(func);
+    return Value();
 }
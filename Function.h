@@ -1,6 +1,7 @@
 #ifndef _NOTENGLISH_FUNCTION_H_INCLUDE_GUARD
 #define _NOTENGLISH_FUNCTION_H_INCLUDE_GUARD
 
+#include <string>
 #include <vector>
 #include "Variable.h"
 
@@ -9,20 +10,56 @@ namespace Ast {
     class Block;
 }
 
+namespace Bytecode {
+    struct Chunk;
+}
+
 class DataHandler;
 
+/**
+ * The position of a ::Scope on the stack of the ::DataHandler.
+ */
+typedef std::size_t ScopeIndex;
+
 class Function {
     DataHandler* data;
+    std::string name;
     std::vector<std::string> args;
+    ScopeIndex home;
     Ast::Block* body;
+    const Bytecode::Chunk* code;
+
+    /**
+     * @throw std::runtime_error if the function was declared but not
+     *  implemented (it has no body to run on the syntax tree)
+     */
+    void checkImplemented() const;
 public:
-    Function(DataHandler* data, const std::vector<std::string>& args);
+    /**
+     * @param home the ::Scope the function is declared in, which is the
+     *  parent of the ::Scope of each call
+     */
+    Function(DataHandler* data, const std::string& name,
+             const std::vector<std::string>& args, ScopeIndex home);
     void setBody(Ast::Block* b);
-    VarPtr call(arg_t& arg_vals);
+    /**
+     * Sets the compiled body, used when running on the Bytecode::VM.
+     */
+    void setCode(const Bytecode::Chunk* c);
+    Value call(arg_t& arg_vals);
+    const Bytecode::Chunk* getCode() const
+    {
+        return code;
+    }
     std::vector<std::string>& getArgs()
     {
         return args;
     }
+
+    ScopeIndex getHome() const
+    {
+        return home;
+    }
 };
 
 #endif // _NOTENGLISH_FUNCTION_H_INCLUDE_GUARD
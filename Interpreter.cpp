@@ -0,0 +1,117 @@
+#include "Interpreter.h"
+#include "Compiler.h"
+#include "Optimizer.h"
+#include "Resolver.h"
+#include "TokenHandler.h"
+#include <ostream>
+
+namespace {
+
+    /**
+     * Runs the front end on the \a part of the source of \a lexer (all of
+     * it if nullptr), into \a program for \a data. The messages of errors
+     * are dropped, the ::ParseError tells all.
+     */
+    void parse(Lexer& lexer, const Lexer::Part* part, DataHandler& data,
+               Ast::Program& program, bool optimize)
+    {
+        std::ostream discard(nullptr);
+        std::ostream* const log = setErrorLog(&discard);
+        try {
+            const TokenStream tokens = part ? lexer.tokenize(*part) : lexer.tokenize();
+            program.setRoot(Parser(tokens, data, program.getArena()).run());
+            Resolver resolver(data);
+            resolver.resolve(program.getRoot());
+            if(optimize)
+                Optimizer(data, resolver, program.getArena()).optimize(program.getRoot());
+            setErrorLog(log);
+        } catch(...) {
+            setErrorLog(log);
+            throw;
+        }
+    }
+
+    /**
+     * Runs the front end and the compiler on the \a part of the source of
+     * \a lexer (all of it if nullptr).
+     */
+    Interpreter::Script build(Lexer& lexer, const Lexer::Part* part, bool optimize)
+    {
+        DataHandler data;
+        Ast::Program program;
+        parse(lexer, part, data, program, optimize);
+        std::shared_ptr<Bytecode::Program> code = std::make_shared<Bytecode::Program>();
+        Bytecode::Compiler(*code).compileProgram(program.getRoot());
+        return code;
+    }
+}
+
+Interpreter::Script Interpreter::compile(const std::string& source, bool optimize)
+{
+    Lexer lexer("");
+    const Lexer::Part part = { source.data(), source.data() + source.size(), 1 };
+    return build(lexer, &part, optimize);
+}
+
+Interpreter::Script Interpreter::compileFile(const std::string& filename, bool optimize)
+{
+    Lexer lexer(filename);
+    return build(lexer, nullptr, optimize);
+}
+
+Interpreter::Interpreter()
+    : own_output(), output(Output::standard()), data(), storage(),
+      used(false)
+{
+
+}
+
+Interpreter::Interpreter(Output::Sink out, sys::Input in)
+    : own_output(new Output::Stream(std::move(out))), output(*own_output), data(),
+      storage(), used(false)
+{
+    data.setIO(output, std::move(in));
+}
+
+void Interpreter::run(const Script& script)
+{
+    reset();
+    used = true;
+    try {
+        Bytecode::VM(data, *script, storage).execute();
+    } catch(...) {
+        output.flush();
+        throw;
+    }
+    output.flush();
+}
+
+void Interpreter::runSource(const std::string& source, bool optimize)
+{
+    reset();
+    used = true;
+    Lexer lexer("");
+    const Lexer::Part part = { source.data(), source.data() + source.size(), 1 };
+    // The functions of the run refer to its syntax tree, the state is
+    // forgotten before the tree is gone
+    Ast::Program program;
+    try {
+        parse(lexer, &part, data, program, optimize);
+        program.getRoot().execute();
+    } catch(...) {
+        output.flush();
+        reset();
+        throw;
+    }
+    output.flush();
+    reset();
+}
+
+void Interpreter::reset()
+{
+    if(used) {
+        data.reset();
+        storage.clear();
+    }
+    used = false;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file Interpreter.h Embeds ~English in other programs (the notenglish
+ * library). A program is compiled to bytecode once and can then be run any
+ * number of times, each time on a fresh state and with the input and
+ * output the embedding program provides:
+ *
+ *     Interpreter::Script script = Interpreter::compile("Display \"Hi\".");
+ *     std::string out;
+ *     Interpreter interpreter([&out](const char* data, std::size_t size) {
+ *         out.append(data, size);
+ *     }, [](std::string&) { return false; });
+ *     interpreter.run(script);
+ */
+#ifndef _NOTENGLISH_INTERPRETER_H_INCLUDE_GUARD
+#define _NOTENGLISH_INTERPRETER_H_INCLUDE_GUARD
+
+#include <memory>
+#include <string>
+#include "Bytecode.h"
+#include "DataHandler.h"
+#include "Output.h"
+#include "SysFunctions.h"
+#include "VM.h"
+
+/**
+ * Runs compiled programs on the virtual machine (see Bytecode::VM), or
+ * source on the syntax tree (Interpreter::runSource). The state of a run
+ * (its variables, scopes and functions, and the frames and registers of the
+ * virtual machine) is kept in the ::Interpreter and reset before the next
+ * run, which reuses its memory.
+ *
+ * An ::Interpreter belongs to the thread using it, the variables of its
+ * programs come from that thread's ::Pool. An Interpreter::Script does not
+ * change when it runs, so one may be run by several interpreters (on
+ * several threads) at once.
+ */
+class Interpreter {
+public:
+    /**
+     * A compiled program.
+     */
+    typedef std::shared_ptr<const Bytecode::Program> Script;
+
+    /**
+     * Compiles the program \a source (folding its constants if
+     * \a optimize). Nothing is printed on errors.
+     * @throw ParseError if it cannot be read, std::runtime_error if it is
+     *  too large for the bytecode
+     */
+    static Script compile(const std::string& source, bool optimize = true);
+
+    /**
+     * Compiles the program in the file \a filename.
+     * @throw ParseError if it cannot be read (or the file cannot),
+     *  std::runtime_error if it is too large for the bytecode
+     */
+    static Script compileFile(const std::string& filename, bool optimize = true);
+
+    /**
+     * An ::Interpreter writing to the standard output and reading the
+     * standard input.
+     */
+    Interpreter();
+
+    /**
+     * An ::Interpreter giving the output of its programs to \a out and
+     * reading their input with \a in.
+     */
+    Interpreter(Output::Sink out, sys::Input in);
+    Interpreter(const Interpreter&) = delete;
+    Interpreter& operator=(const Interpreter&) = delete;
+
+    /**
+     * Runs \a script on a fresh state, all of its output has been given to
+     * the output once this returns.
+     * @throw std::runtime_error if the program fails, the state is reset
+     *  by the next run
+     */
+    void run(const Script& script);
+
+    /**
+     * Runs the program \a source on the syntax tree (see Ast), without
+     * compiling it to bytecode, on a fresh state (folding its constants if
+     * \a optimize). The state is forgotten once it is done.
+     * @throw ParseError if it cannot be read, std::runtime_error if the
+     *  program fails
+     */
+    void runSource(const std::string& source, bool optimize = true);
+
+    /**
+     * Forgets the state of the last run (it is also done by the next one).
+     */
+    void reset();
+
+private:
+    std::unique_ptr<Output::Stream> own_output;
+    Output::Stream& output;
+    DataHandler data;
+    Bytecode::VM::Storage storage;
+    // Whether the state is that of a run
+    bool used;
+};
+
+#endif // _NOTENGLISH_INTERPRETER_H_INCLUDE_GUARD
@@ -0,0 +1,312 @@
+#include "Jit.h"
+#include "Ast.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+
+namespace Jit {
+
+#if defined(__x86_64__)
+    static bool jit_enabled = true;
+#else
+    static bool jit_enabled = false;
+#endif
+
+    bool enabled()
+    {
+        return jit_enabled;
+    }
+
+    void setEnabled(bool on)
+    {
+#if defined(__x86_64__)
+        jit_enabled = on;
+#endif
+    }
+
+    Code::~Code()
+    {
+        if(memory)
+            ::munmap(memory, size);
+    }
+
+    bool Code::load(const std::vector<std::uint8_t>& bytes)
+    {
+        void* p = ::mmap(nullptr, bytes.size(), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(p == MAP_FAILED)
+            return false;
+        std::memcpy(p, bytes.data(), bytes.size());
+        // Never writable and executable at once
+        if(::mprotect(p, bytes.size(), PROT_READ | PROT_EXEC) != 0) {
+            ::munmap(p, bytes.size());
+            return false;
+        }
+        memory = p;
+        size = bytes.size();
+        return true;
+    }
+
+    Compiler::Compiler()
+        : as(), frame(), variables(), nesting(0), top(0)
+    {
+
+    }
+
+    bool Compiler::allocate(Reg& r)
+    {
+        if(top == register_count)
+            return false;
+        r = top++;
+        return true;
+    }
+
+    void Compiler::release(Reg r)
+    {
+        top = r;
+    }
+
+    void Compiler::enter()
+    {
+        ++nesting;
+    }
+
+    void Compiler::leave()
+    {
+        --nesting;
+    }
+
+    bool Compiler::variable(const Binding& b, std::int32_t& disp)
+    {
+        const int depth = b.depth - nesting;
+        if(!b.resolved() || depth < 0)
+            return false;
+        auto it = frame.find(std::make_pair(depth, b.slot));
+        if(it == frame.end()) {
+            it = frame.insert(std::make_pair(std::make_pair(depth, b.slot), variables.size())).first;
+            variables.push_back(Binding(depth, b.slot));
+        }
+        disp = it->second * sizeof(double);
+        return true;
+    }
+
+    void Loop::setCode(Compiler* c)
+    {
+        if(c && code.load(c->assembler().finish())) {
+            variables = c->getVariables();
+            cells.resize(variables.size());
+            frame.resize(variables.size());
+            state = State::Compiled;
+        } else {
+            state = State::Failed;
+        }
+    }
+
+    bool Loop::run(DataHandler& data)
+    {
+        if(state != State::Compiled)
+            return false;
+        for(std::size_t i = 0; i < variables.size(); ++i) {
+            const VarPtr& var = data.getVar(variables[i]);
+            if(!var || !var->isNumber())
+                return false;
+            // Aliases would get a frame slot each
+            if(std::find(cells.begin(), cells.begin() + i, var.get()) != cells.begin() + i)
+                return false;
+            cells[i] = var.get();
+            frame[i] = var->number();
+        }
+        code.entry()(frame.data());
+        for(std::size_t i = 0; i < cells.size(); ++i)
+            *cells[i] = Value(frame[i]);
+        return true;
+    }
+}
+
+// Lowering of the Ast nodes to machine code
+using Jit::Cond;
+using Jit::Label;
+using Jit::Reg;
+
+namespace Ast {
+
+    bool Block::jit(Jit::Compiler& j, Reg dst)
+    {
+        if(!names.empty())
+            return false;
+        j.enter();
+        for(auto& n : stmnts) {
+            if(!n->jit(j, dst))
+                return false;
+        }
+        j.leave();
+        return true;
+    }
+
+    bool Expression::jit(Jit::Compiler& j, Reg dst)
+    {
+        if(!left->jit(j, dst))
+            return false;
+        if(!right)
+            return true;
+        Reg r;
+        if(!j.allocate(r) || !right->jit(j, r))
+            return false;
+        Jit::Assembler& as = j.assembler();
+        switch(op) {
+            case '+': as.add(dst, r); break;
+            case '-': as.sub(dst, r); break;
+            case '*': as.mul(dst, r); break;
+            case '/': as.div(dst, r); break;
+            default:
+                return false;
+        }
+        j.release(r);
+        return true;
+    }
+
+    bool UnaryOp::jit(Jit::Compiler& j, Reg dst)
+    {
+        if(!sub->jit(j, dst))
+            return false;
+        if(op != '-')
+            return true;
+        Reg mask;
+        if(!j.allocate(mask))
+            return false;
+        j.assembler().loadConstant(mask, -0.0);
+        j.assembler().xorpd(dst, mask);
+        j.release(mask);
+        return true;
+    }
+
+    bool Condition::jitBranch(Jit::Compiler& j, bool when, Label target)
+    {
+        Jit::Assembler& as = j.assembler();
+        if(op == '&' || op == '|') {
+            // Jumps as soon as the result is known, both sides are free of
+            // side effects
+            const bool shortcut = (op == '|');
+            if(when == shortcut)
+                return left->jitBranch(j, when, target) && right->jitBranch(j, when, target);
+            Label skip = as.newLabel();
+            if(!left->jitBranch(j, shortcut, skip) || !right->jitBranch(j, when, target))
+                return false;
+            as.bind(skip);
+            return true;
+        }
+        Reg l, r;
+        if(!j.allocate(l) || !left->jit(j, l) || !j.allocate(r) || !right->jit(j, r))
+            return false;
+        // Comparisons with NaN are unordered (ZF, PF and CF set) and false,
+        // except for '!'
+        switch(op) {
+            case '<':
+                as.compare(r, l);
+                as.jump(when ? Cond::Above : Cond::BelowEqual, target);
+                break;
+            case '>':
+                as.compare(l, r);
+                as.jump(when ? Cond::Above : Cond::BelowEqual, target);
+                break;
+            case '=':
+            case '!': {
+                as.compare(l, r);
+                if(when == (op == '=')) {
+                    Label skip = as.newLabel();
+                    as.jump(Cond::Parity, skip);
+                    as.jump(Cond::Equal, target);
+                    as.bind(skip);
+                } else {
+                    as.jump(Cond::Parity, target);
+                    as.jump(Cond::NotEqual, target);
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+        j.release(l);
+        return true;
+    }
+
+    bool Literal::jit(Jit::Compiler& j, Reg dst)
+    {
+        if(!val.isNumber())
+            return false;
+        j.assembler().loadConstant(dst, val.number());
+        return true;
+    }
+
+    bool Literal::jitBranch(Jit::Compiler& j, bool when, Label target)
+    {
+        if(val.getType() != Value::Type::Boolean)
+            return false;
+        if(val.getValue<Value::BoolType>() == when)
+            j.assembler().jump(target);
+        return true;
+    }
+
+    bool Assignment::jit(Jit::Compiler& j, Reg dst)
+    {
+        std::int32_t disp;
+        Reg r;
+        if(!j.variable(binding, disp) || !j.allocate(r) || !value->jit(j, r))
+            return false;
+        j.assembler().store(disp, r);
+        j.release(r);
+        return true;
+    }
+
+    bool VarNode::jit(Jit::Compiler& j, Reg dst)
+    {
+        std::int32_t disp;
+        if(!j.variable(binding, disp))
+            return false;
+        j.assembler().load(dst, disp);
+        return true;
+    }
+
+    bool IfStatement::jit(Jit::Compiler& j, Reg dst)
+    {
+        Jit::Assembler& as = j.assembler();
+        Label to_else = as.newLabel();
+        if(!condition->jitBranch(j, false, to_else) || !body_if->jit(j, dst))
+            return false;
+        if(body_else) {
+            Label to_end = as.newLabel();
+            as.jump(to_end);
+            as.bind(to_else);
+            if(!body_else->jit(j, dst))
+                return false;
+            as.bind(to_end);
+        } else {
+            as.bind(to_else);
+        }
+        return true;
+    }
+
+    bool WhileStatement::jit(Jit::Compiler& j, Reg dst)
+    {
+        Jit::Assembler& as = j.assembler();
+        Label loop = as.newLabel();
+        Label to_end = as.newLabel();
+        as.bind(loop);
+        if(!condition->jitBranch(j, false, to_end) || !body->jit(j, dst))
+            return false;
+        as.jump(loop);
+        as.bind(to_end);
+        return true;
+    }
+
+    void WhileStatement::compileNative()
+    {
+        Jit::Compiler j;
+        if(!jit(j, 0)) {
+            native.setCode(nullptr);
+            return;
+        }
+        j.assembler().ret();
+        native.setCode(&j);
+    }
+}
@@ -0,0 +1,160 @@
+/**
+ * @file Jit.h Compiles hot numeric `While` loops of the syntax tree to
+ * x86-64 machine code (see Assembler.h). A loop qualifies when it only
+ * assigns arithmetic on numbers to variables declared outside of it, and
+ * compares them (possibly in nested `If` and `While` statements): anything
+ * else, like a function call or a variable declaration, keeps it on the
+ * interpreter.
+ */
+#ifndef _NOTENGLISH_JIT_H_INCLUDE_GUARD
+#define _NOTENGLISH_JIT_H_INCLUDE_GUARD
+
+#include <map>
+#include <vector>
+#include "Assembler.h"
+#include "DataHandler.h"
+
+namespace Jit {
+
+    /**
+     * @return whether hot loops are compiled, which is only possible on
+     *  x86-64
+     */
+    bool enabled();
+    void setEnabled(bool on);
+
+    /**
+     * A piece of executable memory holding a compiled loop. The generated
+     * function takes the frame (the values of the loop's variables, see
+     * Compiler::getVariables) and runs the loop to its end.
+     */
+    class Code {
+        void* memory;
+        std::size_t size;
+    public:
+        typedef void (*Entry)(double* frame);
+
+        Code()
+            : memory(nullptr), size(0) {}
+        ~Code();
+        Code(const Code&) = delete;
+        Code& operator=(const Code&) = delete;
+
+        /**
+         * Copies \a bytes into fresh executable memory.
+         * @return false if no such memory could be mapped
+         */
+        bool load(const std::vector<std::uint8_t>& bytes);
+
+        bool loaded() const
+        {
+            return memory != nullptr;
+        }
+
+        Entry entry() const
+        {
+            return reinterpret_cast<Entry>(memory);
+        }
+    };
+
+    /**
+     * Lowers a loop to machine code. The actual lowering of each node is
+     * done by Ast::Node::jit and Ast::Node::jitBranch, which give up (return
+     * false) on anything the ::Jit cannot handle.
+     *
+     * Every variable used by the loop gets a slot of the frame, variables
+     * are known by their ::Binding as seen from the scope running the loop.
+     * The nodes are in the blocks of the loop, which have no variables (so
+     * need no ::Scope), each block entered adds one to the depth of the
+     * bindings inside it.
+     */
+    class Compiler {
+        Assembler as;
+        std::map<std::pair<int, std::size_t>, std::size_t> frame;
+        std::vector<Binding> variables;
+        int nesting;
+        Reg top;
+    public:
+        Compiler();
+
+        Assembler& assembler()
+        {
+            return as;
+        }
+
+        /**
+         * Allocates a register, in stack order.
+         * @return false if all registers are taken
+         */
+        bool allocate(Reg& r);
+        void release(Reg r);
+
+        void enter();
+        void leave();
+
+        /**
+         * Finds the frame slot of the variable \a b.
+         * @return false if it is not declared outside of the loop
+         */
+        bool variable(const Binding& b, std::int32_t& disp);
+
+        /**
+         * The variables of the frame, seen from the scope running the loop.
+         */
+        const std::vector<Binding>& getVariables() const
+        {
+            return variables;
+        }
+    };
+
+    /**
+     * The native state of one loop: it is compiled once it has run
+     * Loop::threshold iterations on the interpreter.
+     */
+    class Loop {
+        enum class State : std::uint8_t {
+            Cold, Compiled, Failed
+        };
+
+        Code code;
+        std::vector<Binding> variables;
+        // The cells of the variables and the frame of numbers the code
+        // runs on, sized once the loop is compiled and filled on each run
+        std::vector<Variable*> cells;
+        std::vector<double> frame;
+        unsigned iterations;
+        State state;
+    public:
+        static const unsigned threshold = 1000;
+
+        Loop()
+            : code(), variables(), cells(), frame(), iterations(0),
+              state(State::Cold) {}
+
+        /**
+         * Counts an interpreted iteration.
+         * @return whether the loop should be compiled now
+         */
+        bool hot()
+        {
+            return state == State::Cold && ++iterations == threshold && enabled();
+        }
+
+        /**
+         * Sets the result of compiling the loop (nullptr if it could not be
+         * compiled).
+         */
+        void setCode(Compiler* c);
+
+        /**
+         * Runs the compiled loop to its end from the current state of its
+         * variables.
+         * @return false if it is not compiled or one of the variables is not
+         *  a number (or used twice, by reference), the interpreter has to
+         *  go on then
+         */
+        bool run(DataHandler& data);
+    };
+}
+
+#endif // _NOTENGLISH_JIT_H_INCLUDE_GUARD
@@ -0,0 +1,140 @@
+// Generated by tools/gen_keywords.py, do not edit.
+#include "TokenStream.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    struct Keyword {
+        const char* word;
+        std::size_t length;
+        TokenType type;
+    };
+
+    const Keyword keywords[] = {
+        { "", 0, TokenType::Unkown },
+        { "Declare", 7, TokenType::Declaration },
+        { "Create", 6, TokenType::Declaration },
+        { "Make", 4, TokenType::Declaration },
+        { "Construct", 9, TokenType::Declaration },
+        { "Spawn", 5, TokenType::Declaration },
+        { "Manufacture", 11, TokenType::Declaration },
+        { "Name", 4, TokenType::Declaration },
+        { "Label", 5, TokenType::Declaration },
+        { "Change", 6, TokenType::SetVar },
+        { "Set", 3, TokenType::SetVar },
+        { "Vary", 4, TokenType::SetVar },
+        { "Alter", 5, TokenType::SetVar },
+        { "Modify", 6, TokenType::SetVar },
+        { "Adjust", 6, TokenType::SetVar },
+        { "value", 5, TokenType::ValueOf },
+        { "a", 1, TokenType::Article },
+        { "an", 2, TokenType::Article },
+        { "another", 7, TokenType::Article },
+        { "the", 3, TokenType::Article },
+        { "or", 2, TokenType::Or },
+        { "and", 3, TokenType::And },
+        { "to", 2, TokenType::To },
+        { "by", 2, TokenType::To },
+        { "into", 4, TokenType::To },
+        { "named", 5, TokenType::KnownAs },
+        { "called", 6, TokenType::KnownAs },
+        { "labeled", 7, TokenType::KnownAs },
+        { "titled", 6, TokenType::KnownAs },
+        { "Stop", 4, TokenType::End },
+        { "End", 3, TokenType::End },
+        { "Quit", 4, TokenType::End },
+        { "Exit", 4, TokenType::End },
+        { "plus", 4, TokenType::Plus },
+        { "minus", 5, TokenType::Minus },
+        { "times", 5, TokenType::Times },
+        { "If", 2, TokenType::If },
+        { "Otherwise", 9, TokenType::Else },
+        { "Else", 4, TokenType::Else },
+        { "equals", 6, TokenType::Equals },
+        { "differs", 7, TokenType::NotEquals },
+        { "That's", 6, TokenType::BlockEnd },
+        { "then:", 5, TokenType::BlockBegin },
+        { "do:", 3, TokenType::BlockBegin },
+        { "is", 2, TokenType::Is },
+        { "Call", 4, TokenType::FuncName },
+        { "Execute", 7, TokenType::FuncName },
+        { "Evaluate", 8, TokenType::FuncName },
+        { "result", 6, TokenType::FuncResult },
+        { "outcome", 7, TokenType::FuncResult },
+        { "on", 2, TokenType::On },
+        { "with", 4, TokenType::On },
+        { "of", 2, TokenType::Of },
+        { "from", 4, TokenType::Of },
+        { "While", 5, TokenType::While },
+        { "Note", 4, TokenType::Comment },
+        { "Notice", 6, TokenType::Comment },
+        { "Note:", 5, TokenType::Comment },
+        { "Notice:", 7, TokenType::Comment },
+        { "argument", 8, TokenType::Argument },
+        { "arguments", 9, TokenType::Argument },
+        { "parameter", 9, TokenType::Argument },
+        { "parameters", 10, TokenType::Argument },
+        { "When", 4, TokenType::When },
+        { "Whenever", 8, TokenType::When },
+        { "Upon", 4, TokenType::When },
+        { "calling", 7, TokenType::Calling },
+        { "executing", 9, TokenType::Calling },
+        { "evaluating", 10, TokenType::Calling },
+        { "running", 7, TokenType::Calling },
+    };
+
+    const unsigned table_bits = 9;
+
+    // Index into keywords for each hash value (0 if none)
+    const std::uint8_t slots[1 << table_bits] = {
+        0, 0, 0, 6, 14, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 43, 0, 0, 0, 0, 0, 0,
+        63, 0, 0, 0, 5, 0, 0, 0, 12, 0, 0, 0, 0, 0, 0, 0,
+        0, 41, 0, 0, 51, 0, 0, 0, 0, 0, 0, 7, 0, 0, 19, 25,
+        0, 0, 0, 0, 55, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 48, 56, 0, 0, 0, 0,
+        0, 0, 0, 0, 36, 0, 0, 0, 0, 0, 38, 0, 0, 0, 69, 0,
+        0, 0, 0, 0, 17, 30, 0, 22, 0, 0, 0, 24, 0, 0, 0, 0,
+        0, 0, 0, 0, 45, 32, 0, 34, 0, 0, 0, 18, 0, 0, 44, 0,
+        0, 0, 46, 0, 0, 0, 0, 0, 47, 0, 23, 42, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 20, 3, 0, 0,
+        0, 0, 40, 29, 50, 0, 0, 0, 16, 64, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 52, 0, 0, 0, 0, 0, 0, 0, 0, 49, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 39, 0, 0, 66, 0, 0, 0, 26,
+        28, 0, 0, 0, 0, 21, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 62, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 15, 0, 0, 0,
+        0, 0, 0, 0, 59, 0, 0, 0, 10, 57, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 53, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 35, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 65, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 9, 0, 60, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 13, 0, 0, 0, 0, 0, 68,
+        0, 0, 11, 0, 0, 33, 37, 0, 0, 0, 0, 31, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        67, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 58, 0, 0, 0, 0,
+        54, 0, 0, 0, 8, 0, 27, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 61, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    };
+
+    // FNV-1a, seeded such that no two keywords collide
+    inline std::uint32_t keywordHash(const char* s, std::size_t n)
+    {
+        std::uint32_t h = 2166136389u;
+        for(std::size_t i = 0; i < n; ++i)
+            h = (h ^ static_cast<unsigned char>(s[i])) * 16777619u;
+        return h >> (32 - table_bits);
+    }
+}
+
+TokenType lookupKeyword(boost::string_view word)
+{
+    const Keyword& k = keywords[slots[keywordHash(word.data(), word.size())]];
+    if(k.length != word.size() || std::memcmp(k.word, word.data(), k.length) != 0)
+        return TokenType::Unkown;
+    return k.type;
+}
@@ -0,0 +1,141 @@
+#include "Optimizer.h"
+#include <stdexcept>
+
+Optimizer::Optimizer(DataHandler& d, const Resolver& r, Arena& a)
+    : data(d), resolver(r), arena(a)
+{
+
+}
+
+void Optimizer::optimize(Ast::Block& program)
+{
+    program.fold(*this);
+}
+
+void Optimizer::fold(Ast::NodePtr& n)
+{
+    // A node replaced by one of its children has released it already
+    if(Ast::Node* replacement = n->fold(*this))
+        n.reset(replacement);
+}
+
+Ast::Node* Optimizer::constant(std::size_t slot)
+{
+    if(resolver.isWritten(slot))
+        return nullptr;
+    return literal(data.getConstant(slot));
+}
+
+Ast::Node* Optimizer::apply(char op, const Ast::Node& lhs, const Ast::Node& rhs)
+{
+    const Value* vleft = lhs.literal();
+    const Value* vright = rhs.literal();
+    if(!vleft || !vright)
+        return nullptr;
+    try {
+        return literal(Value::apply(op, *vleft, *vright));
+    } catch(const std::runtime_error&) {
+        // The program only fails if it gets there
+        return nullptr;
+    }
+}
+
+Ast::Node* Optimizer::literal(const Value& v)
+{
+    return new (arena) Ast::Literal(v);
+}
+
+// Folding of the Ast nodes
+
+namespace Ast {
+
+    Node* Block::fold(Optimizer& o)
+    {
+        for(auto& n : stmnts)
+            o.fold(n);
+        return nullptr;
+    }
+
+    Node* Expression::fold(Optimizer& o)
+    {
+        o.fold(left);
+        if(!right)
+            return left.release();
+        o.fold(right);
+        return o.apply(op, *left, *right);
+    }
+
+    Node* UnaryOp::fold(Optimizer& o)
+    {
+        o.fold(sub);
+        if(op != '-')
+            return sub.release();
+        if(const Value* v = sub->literal())
+            return o.literal(Value::negate(*v));
+        return nullptr;
+    }
+
+    Node* Condition::fold(Optimizer& o)
+    {
+        o.fold(left);
+        o.fold(right);
+        return o.apply(op, *left, *right);
+    }
+
+    Node* Literal::fold(Optimizer& o)
+    {
+        return nullptr;
+    }
+
+    Node* FunctionCall::fold(Optimizer& o)
+    {
+        for(auto& arg : args)
+            o.fold(arg);
+        return nullptr;
+    }
+
+    Node* Assignment::fold(Optimizer& o)
+    {
+        o.fold(value);
+        return nullptr;
+    }
+
+    Node* VarDeclaration::fold(Optimizer& o)
+    {
+        return nullptr;
+    }
+
+    Node* FuncDeclaration::fold(Optimizer& o)
+    {
+        return nullptr;
+    }
+
+    Node* FuncImpl::fold(Optimizer& o)
+    {
+        body->fold(o);
+        return nullptr;
+    }
+
+    Node* VarNode::fold(Optimizer& o)
+    {
+        if(builtin)
+            return o.constant(binding.slot);
+        return nullptr;
+    }
+
+    Node* IfStatement::fold(Optimizer& o)
+    {
+        o.fold(condition);
+        body_if->fold(o);
+        if(body_else)
+            body_else->fold(o);
+        return nullptr;
+    }
+
+    Node* WhileStatement::fold(Optimizer& o)
+    {
+        o.fold(condition);
+        body->fold(o);
+        return nullptr;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef _NOTENGLISH_OPTIMIZER_H_INCLUDE_GUARD
+#define _NOTENGLISH_OPTIMIZER_H_INCLUDE_GUARD
+
+#include "Ast.h"
+#include "Resolver.h"
+
+/**
+ * Simplifies a resolved program before it is executed (or compiled):
+ * operators on literals are folded, the built-in constants the program
+ * never changes become literals, and the pass-through Ast::UnaryOp and
+ * Ast::Expression wrappers made by the ::Parser are dropped. The actual
+ * walk over the tree is done by Ast::Node::fold.
+ *
+ * Folding keeps the behaviour of the program: operators that would fail
+ * are left to fail at runtime, and an operand passed to a function stays
+ * a reference to the same variable.
+ */
+class Optimizer {
+    DataHandler& data;
+    const Resolver& resolver;
+    Arena& arena;
+public:
+    Optimizer(DataHandler& d, const Resolver& r, Arena& a);
+
+    /**
+     * Optimizes the main program, which has to be resolved.
+     */
+    void optimize(Ast::Block& program);
+
+    /**
+     * Folds \a n, replacing it if it could be simplified.
+     */
+    void fold(Ast::NodePtr& n);
+
+    /**
+     * @return a literal for the built-in constant in \a slot, nullptr if
+     *  the program may change it
+     */
+    Ast::Node* constant(std::size_t slot);
+
+    /**
+     * Applies the binary operator \a op to two literals.
+     * @return the resulting literal, nullptr if the operands are no
+     *  literals or the operator fails on them
+     */
+    Ast::Node* apply(char op, const Ast::Node& lhs, const Ast::Node& rhs);
+
+    Ast::Node* literal(const Value& v);
+};
+
+#endif // _NOTENGLISH_OPTIMIZER_H_INCLUDE_GUARD
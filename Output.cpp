@@ -0,0 +1,346 @@
+#include "Output.h"
+#include <cerrno>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace Output {
+
+    namespace {
+
+        const std::size_t capacity = 64 * 1024;
+
+        void writeStandard(const char* data, std::size_t size)
+        {
+            while(size != 0) {
+                const ssize_t n = ::write(STDOUT_FILENO, data, size);
+                if(n < 0) {
+                    if(errno == EINTR)
+                        continue;
+                    // Nowhere to write to (a closed pipe), like std::cout
+                    // the output is lost
+                    return;
+                }
+                data += n;
+                size -= n;
+            }
+        }
+
+        const int max_digits = 17;
+
+        /**
+         * A number as its significant digits and decimal exponent.
+         */
+        struct Decimal {
+            bool negative;
+            char digits[max_digits];
+            int exponent;
+
+            /**
+             * Prints the first \a precision digits like printf's %g does.
+             * @return the number of characters written
+             */
+            std::size_t print(int precision, char* buf) const
+            {
+                int count = precision;
+                while(count > 1 && digits[count - 1] == '0')
+                    --count;
+                char* p = buf;
+                if(negative)
+                    *p++ = '-';
+                if(exponent < -4 || exponent >= precision) {
+                    *p++ = digits[0];
+                    if(count > 1) {
+                        *p++ = '.';
+                        for(int i = 1; i < count; ++i)
+                            *p++ = digits[i];
+                    }
+                    p += std::sprintf(p, "e%c%02d", exponent < 0 ? '-' : '+', std::abs(exponent));
+                } else if(exponent < 0) {
+                    *p++ = '0';
+                    *p++ = '.';
+                    for(int i = -1; i > exponent; --i)
+                        *p++ = '0';
+                    for(int i = 0; i < count; ++i)
+                        *p++ = digits[i];
+                } else {
+                    for(int i = 0; i <= exponent; ++i)
+                        *p++ = i < count ? digits[i] : '0';
+                    if(count > exponent + 1) {
+                        *p++ = '.';
+                        for(int i = exponent + 1; i < count; ++i)
+                            *p++ = digits[i];
+                    }
+                }
+                *p = '\0';
+                return p - buf;
+            }
+        };
+
+        /**
+         * Converts the finite \a d to \a precision correctly rounded digits.
+         */
+        void decimal(double d, int precision, Decimal& result)
+        {
+            // [-]d.ddde[+-]xx
+            char sci[number_size];
+            std::snprintf(sci, sizeof(sci), "%.*e", precision - 1, d);
+            const char* p = sci;
+            result.negative = *p == '-';
+            if(result.negative)
+                ++p;
+            for(int i = 0; i < precision; ++i, ++p) {
+                if(*p == '.')
+                    ++p;
+                result.digits[i] = *p;
+            }
+            result.exponent = std::atoi(p + 1);
+        }
+
+        /**
+         * Rounds the digits of \a exact to \a precision digits, which gives
+         * the digits the number itself rounds to unless the dropped digits
+         * are a tie.
+         * @return false if they are
+         */
+        bool round(const Decimal& exact, int precision, Decimal& result)
+        {
+            const char first = exact.digits[precision];
+            bool tie = first == '5';
+            for(int i = precision + 1; tie && i < max_digits; ++i)
+                tie = exact.digits[i] == '0';
+            if(tie)
+                return false;
+            result = exact;
+            if(first >= '5') {
+                int i = precision - 1;
+                while(i >= 0 && result.digits[i] == '9')
+                    result.digits[i--] = '0';
+                if(i >= 0) {
+                    ++result.digits[i];
+                } else {
+                    result.digits[0] = '1';
+                    ++result.exponent;
+                }
+            }
+            return true;
+        }
+
+#if defined(__SIZEOF_INT128__)
+        typedef unsigned __int128 Wide;
+
+        /**
+         * Finds the shortest digits of the finite, non-zero \a d with exact
+         * integer arithmetic, which is a lot faster than printf and strtod.
+         * @return false if \a d is too large or small for it
+         */
+        bool shortest(double d, Decimal& result, int& precision)
+        {
+            // |d| = m * 2^e
+            int e;
+            const double fraction = std::frexp(std::fabs(d), &e);
+            const std::uint64_t m = static_cast<std::uint64_t>(std::ldexp(fraction, 53));
+            e -= 53;
+            // Scaled by 10^k to num / den, |d| should have max_digits digits
+            // before the point, the guess of k can be one off
+            int k = max_digits - 1 - static_cast<int>(std::floor(std::log10(std::fabs(d))));
+            const std::uint64_t low = 10000000000000000ull;
+            const std::uint64_t high = low * 10;
+            for(int attempt = 0; attempt < 3; ++attempt) {
+                // 10^k < 2^(10k/3). The distances to the candidates below
+                // take up to 8 more bits than den.
+                const int pow_bits = (std::abs(k) * 10 + 2) / 3;
+                const int num_bits = 53 + (k > 0 ? pow_bits : 0) + (e > 0 ? e : 0);
+                const int den_bits = (k < 0 ? pow_bits : 0) + (e < 0 ? -e : 0);
+                if(num_bits > 120 || den_bits > 119)
+                    return false;
+                Wide pow = 1;
+                for(int i = std::abs(k); i > 0; --i)
+                    pow *= 10;
+                Wide num = m;
+                Wide den = 1;
+                if(k > 0)
+                    num *= pow;
+                else
+                    den = pow;
+                if(e > 0)
+                    num <<= e;
+                else
+                    den <<= -e;
+                const Wide wide_q = num / den;
+                if(wide_q < low) {
+                    ++k;
+                    continue;
+                }
+                if(wide_q >= high) {
+                    --k;
+                    continue;
+                }
+                const std::uint64_t q = static_cast<std::uint64_t>(wide_q);
+                const Wide r = num - wide_q * den;
+                // Four times half the distance to the next double, times den;
+                // the one below is half as far at a power of two
+                Wide reach = 2;
+                if(k > 0)
+                    reach *= pow;
+                if(e > 0)
+                    reach <<= e;
+                const Wide reach_below = m == (1ull << 52) ? reach / 2 : reach;
+                std::uint64_t c = 0;
+                std::uint64_t unit = 100;
+                for(precision = 15; precision < max_digits; ++precision, unit /= 10) {
+                    // Rounds num / den to a multiple of unit, half to even
+                    const std::uint64_t rem = q % unit;
+                    const std::uint64_t base = q - rem;
+                    const bool up = rem * 2 > unit
+                        || (rem * 2 == unit && (r != 0 || (base / unit) % 2 == 1));
+                    c = up ? base + unit : base;
+                    // c reads back as d if it is closer than the next double
+                    const Wide distance = up ? (unit - rem) * den - r : rem * den + r;
+                    const Wide limit = up ? reach : reach_below;
+                    if(distance * 4 < limit || (distance * 4 == limit && m % 2 == 0))
+                        break;
+                }
+                // All 17 digits read back as d
+                if(precision == max_digits) {
+                    c = q;
+                    if(r * 2 > den || (r * 2 == den && q % 2 == 1))
+                        ++c;
+                }
+                int exponent = max_digits - 1 - k;
+                if(c == high) {
+                    c = low;
+                    ++exponent;
+                }
+                result.negative = d < 0;
+                for(int i = max_digits - 1; i >= 0; --i) {
+                    result.digits[i] = '0' + c % 10;
+                    c /= 10;
+                }
+                result.exponent = exponent;
+                return true;
+            }
+            return false;
+        }
+#else
+        bool shortest(double d, Decimal& result, int& precision)
+        {
+            return false;
+        }
+#endif
+    }
+
+    std::size_t format(double d, char* buf)
+    {
+        // Most numbers shown are integers, which need no search
+        if(d == std::trunc(d) && std::fabs(d) < 1e15 && !(d == 0 && std::signbit(d))) {
+            long long n = static_cast<long long>(d);
+            char digits[number_size];
+            std::size_t count = 0;
+            const bool negative = n < 0;
+            if(negative)
+                n = -n;
+            do {
+                digits[count++] = '0' + n % 10;
+                n /= 10;
+            } while(n != 0);
+            std::size_t size = 0;
+            if(negative)
+                buf[size++] = '-';
+            while(count != 0)
+                buf[size++] = digits[--count];
+            buf[size] = '\0';
+            return size;
+        }
+        if(!std::isfinite(d))
+            return std::snprintf(buf, number_size, "%g", d);
+        Decimal result;
+        int precision;
+        if(d != 0 && shortest(d, result, precision))
+            return result.print(precision, buf);
+        // 17 significant digits always read back the same double, fewer
+        // are tried first by rounding them (in decimal)
+        Decimal exact;
+        decimal(d, max_digits, exact);
+        // Subnormal numbers have fewer significant digits
+        for(precision = std::fabs(d) < DBL_MIN ? 1 : 15; precision < max_digits; ++precision) {
+            if(!round(exact, precision, result))
+                decimal(d, precision, result);
+            const std::size_t size = result.print(precision, buf);
+            if(std::strtod(buf, nullptr) == d)
+                return size;
+        }
+        return exact.print(max_digits, buf);
+    }
+
+    Stream::Stream()
+        : sink(writeStandard), data(new char[capacity]), size(0), buffered(true),
+          tty(::isatty(STDOUT_FILENO)), line(false)
+    {
+
+    }
+
+    Stream::Stream(Sink s)
+        : sink(std::move(s)), data(new char[capacity]), size(0), buffered(true),
+          tty(false), line(false)
+    {
+
+    }
+
+    Stream::~Stream()
+    {
+        flush();
+    }
+
+    void Stream::write(const char* d, std::size_t n)
+    {
+        if(n > capacity - size) {
+            flush();
+            if(n >= capacity) {
+                sink(d, n);
+                return;
+            }
+        }
+        std::memcpy(data.get() + size, d, n);
+        size += n;
+        if(tty && !line && std::memchr(d, '\n', n))
+            line = true;
+    }
+
+    void Stream::write(double d)
+    {
+        char buf[number_size];
+        write(buf, format(d, buf));
+    }
+
+    void Stream::commit()
+    {
+        if(!buffered || line)
+            flush();
+    }
+
+    void Stream::flush()
+    {
+        if(size != 0)
+            sink(data.get(), size);
+        size = 0;
+        line = false;
+    }
+
+    void Stream::setBuffered(bool on)
+    {
+        buffered = on;
+        commit();
+    }
+
+    Stream& standard()
+    {
+        // Flushed when destroyed at exit
+        static Stream s;
+        return s;
+    }
+}
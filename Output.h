@@ -0,0 +1,80 @@
+/**
+ * @file Output.h The output of programs (everything `Display` writes).
+ * Output is collected in a large buffer and written with as few system
+ * calls as possible: when the buffer is full, before input is read, at exit
+ * and, if the output is a terminal, after a call that wrote a newline.
+ * Each ::DataHandler writes to an Output::Stream, which is the standard
+ * output unless it is given another one.
+ */
+#ifndef _NOTENGLISH_OUTPUT_H_INCLUDE_GUARD
+#define _NOTENGLISH_OUTPUT_H_INCLUDE_GUARD
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace Output {
+
+    /**
+     * The room Output::format needs.
+     */
+    const std::size_t number_size = 32;
+
+    /**
+     * Writes \a d to \a buf with the fewest digits that still read back as
+     * \a d.
+     * @return the number of characters written
+     */
+    std::size_t format(double d, char* buf);
+
+    /**
+     * Takes the output of a ::Stream when it is flushed.
+     */
+    typedef std::function<void(const char* data, std::size_t size)> Sink;
+
+    /**
+     * Buffers output for a ::Sink, the rest is flushed when the ::Stream
+     * is gone.
+     */
+    class Stream {
+        Sink sink;
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+        bool buffered;
+        bool tty;
+        // A newline was written to the terminal since the last flush
+        bool line;
+    public:
+        /**
+         * A ::Stream of the standard output.
+         */
+        Stream();
+        explicit Stream(Sink sink);
+        ~Stream();
+        Stream(const Stream&) = delete;
+        Stream& operator=(const Stream&) = delete;
+
+        void write(const char* data, std::size_t size);
+        void write(double d);
+
+        /**
+         * Ends a call writing output, which is flushed if it has to be
+         * seen now.
+         */
+        void commit();
+        void flush();
+
+        /**
+         * Turns the buffering off (flushing after every call) or back on.
+         */
+        void setBuffered(bool on);
+    };
+
+    /**
+     * @return the ::Stream of the standard output of the process, which is
+     *  flushed at exit
+     */
+    Stream& standard();
+}
+
+#endif // _NOTENGLISH_OUTPUT_H_INCLUDE_GUARD
@@ -0,0 +1,136 @@
+#include "ParallelParser.h"
+#include "TokenHandler.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <ostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    // A few parts for each thread, so none waits long for the last one
+    const unsigned parts_per_job = 4;
+
+    struct Result {
+        Lexer::Part part;
+        std::unique_ptr<Ast::Block> block;
+        bool stopped;
+        // The messages of the error, if any
+        std::ostringstream log;
+        std::exception_ptr failure;
+
+        Result(const Lexer::Part& p)
+            : part(p), block(), stopped(false), log(), failure() {}
+    };
+}
+
+ParallelParser::ParallelParser(const std::string& f, DataHandler& d, unsigned j)
+    : filename(f), data(d), jobs(std::max(j, 1u))
+{
+
+}
+
+Ast::Block* ParallelParser::run(Ast::Program& program)
+{
+    // The parts are parsed while the rest of the source is being split,
+    // the workers start once there is a second one
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<Result> results;
+    bool done = false;
+    std::size_t next = 0;
+    // The first part that failed or stopped, the ones after it are skipped
+    std::size_t last = std::numeric_limits<std::size_t>::max();
+    auto work = [&]() {
+        while(true) {
+            Result* r;
+            Arena* arena;
+            std::size_t i;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                ready.wait(guard, [&]() { return next < results.size() || done; });
+                if(next == results.size() || next > last)
+                    return;
+                i = next++;
+                r = &results[i];
+                arena = &program.addArena();
+            }
+            // The calling thread works too, its own log is kept
+            std::ostream* const log = setErrorLog(&r->log);
+            try {
+                Lexer part(filename);
+                const TokenStream tokens = part.tokenize(r->part);
+                Parser parser(tokens, data, *arena);
+                r->block.reset(parser.run());
+                r->stopped = parser.hasStopped();
+            } catch(...) {
+                r->failure = std::current_exception();
+            }
+            setErrorLog(log);
+            if(r->failure || r->stopped) {
+                std::lock_guard<std::mutex> guard(lock);
+                last = std::min(last, i);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    auto finish = [&]() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            done = true;
+        }
+        ready.notify_all();
+        for(std::thread& t : threads)
+            t.join();
+        threads.clear();
+    };
+
+    Lexer lexer(filename);
+    try {
+        lexer.split(jobs > 1 ? jobs * parts_per_job : 1, min_part, [&](const Lexer::Part& part) {
+            std::size_t count;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                results.emplace_back(part);
+                count = results.size();
+            }
+            ready.notify_one();
+            if(count == 2) {
+                for(unsigned t = 1; t < jobs; ++t)
+                    threads.emplace_back(work);
+            }
+        });
+    } catch(...) {
+        finish();
+        throw;
+    }
+    if(results.size() == 1) {
+        const TokenStream tokens = lexer.tokenize(results.front().part);
+        return Parser(tokens, data, program.getArena()).run();
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        done = true;
+    }
+    ready.notify_all();
+    work();
+    finish();
+
+    std::unique_ptr<Ast::Block> root(new (program.getArena()) Ast::Block(&data));
+    for(Result& r : results) {
+        if(r.failure) {
+            errorLog() << r.log.str();
+            std::rethrow_exception(r.failure);
+        }
+        for(Ast::NodePtr& statement : r.block->takeStatements())
+            root->attach(statement.release());
+        if(r.stopped)
+            break;
+    }
+    return root.release();
+}
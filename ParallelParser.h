@@ -0,0 +1,47 @@
+/**
+ * @file ParallelParser.h Lexes and parses a large program on several
+ * threads.
+ */
+#ifndef _NOTENGLISH_PARALLELPARSER_H_INCLUDE_GUARD
+#define _NOTENGLISH_PARALLELPARSER_H_INCLUDE_GUARD
+
+#include <cstddef>
+#include <string>
+#include "Ast.h"
+#include "DataHandler.h"
+
+/**
+ * Splits the source of a program into parts at top-level sentences (see
+ * Lexer::split), which are lexed and parsed on worker threads into arenas
+ * of their own while the rest of the source is still being split. Their
+ * statements are then joined in order into the root block, so the syntax
+ * tree is the one the ::Parser makes of the whole program, with the same
+ * line numbers.
+ *
+ * Errors are reported like they are on one thread: only the first one in
+ * the program counts, and nothing after a "Stop" is looked at. Small
+ * programs are read on the calling thread.
+ */
+class ParallelParser {
+    std::string filename;
+    DataHandler& data;
+    unsigned jobs;
+public:
+    /**
+     * Parts are no smaller than this (in bytes).
+     */
+    static const std::size_t min_part = 1 << 20;
+
+    /**
+     * @param jobs the number of threads to use (including the calling one)
+     */
+    ParallelParser(const std::string& filename, DataHandler& data, unsigned jobs);
+
+    /**
+     * @return the root block of the program, whose nodes live in the arenas
+     *  of \a program
+     */
+    Ast::Block* run(Ast::Program& program);
+};
+
+#endif // _NOTENGLISH_PARALLELPARSER_H_INCLUDE_GUARD
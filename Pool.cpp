@@ -0,0 +1,86 @@
+#include "Pool.h"
+#include <vector>
+
+namespace {
+    const std::size_t granularity = 16;
+    const std::size_t size_classes = 8; // up to 128 bytes
+    const std::size_t chunk_size = 32 * 1024;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct ThreadPool {
+        FreeBlock* free_lists[size_classes];
+        std::vector<void*> chunks;
+        Pool::Stats stats;
+
+        ThreadPool()
+            : free_lists(), chunks(), stats()
+        {
+
+        }
+
+        ~ThreadPool()
+        {
+            for(void* chunk : chunks)
+                ::operator delete(chunk);
+        }
+
+        // Carves a new chunk into blocks of the given size class
+        void refill(std::size_t size_class)
+        {
+            const std::size_t block = (size_class + 1) * granularity;
+            char* chunk = static_cast<char*>(::operator new(chunk_size));
+            chunks.push_back(chunk);
+            ++stats.chunks;
+            FreeBlock* list = free_lists[size_class];
+            for(std::size_t offset = 0; offset + block <= chunk_size; offset += block) {
+                FreeBlock* b = reinterpret_cast<FreeBlock*>(chunk + offset);
+                b->next = list;
+                list = b;
+            }
+            free_lists[size_class] = list;
+        }
+    };
+
+    thread_local ThreadPool pool;
+
+    std::size_t sizeClass(std::size_t size)
+    {
+        return (size + granularity - 1) / granularity - 1;
+    }
+}
+
+void* Pool::allocate(std::size_t size)
+{
+    ++pool.stats.allocations;
+    if(++pool.stats.live > pool.stats.peak)
+        pool.stats.peak = pool.stats.live;
+    if(size == 0 || size > granularity * size_classes)
+        return ::operator new(size);
+    const std::size_t size_class = sizeClass(size);
+    if(!pool.free_lists[size_class])
+        pool.refill(size_class);
+    FreeBlock* b = pool.free_lists[size_class];
+    pool.free_lists[size_class] = b->next;
+    return b;
+}
+
+void Pool::deallocate(void* p, std::size_t size)
+{
+    --pool.stats.live;
+    if(size == 0 || size > granularity * size_classes) {
+        ::operator delete(p);
+        return;
+    }
+    FreeBlock* b = static_cast<FreeBlock*>(p);
+    const std::size_t size_class = sizeClass(size);
+    b->next = pool.free_lists[size_class];
+    pool.free_lists[size_class] = b;
+}
+
+Pool::Stats Pool::getStats()
+{
+    return pool.stats;
+}
@@ -0,0 +1,68 @@
+#ifndef _NOTENGLISH_POOL_H_INCLUDE_GUARD
+#define _NOTENGLISH_POOL_H_INCLUDE_GUARD
+
+#include <cstddef>
+#include <new>
+
+/**
+ * A size-class pool for small objects which are allocated and freed all the
+ * time (the ::Variable cells). Freed blocks are kept on a free list per size
+ * class and handed out again. Each thread has its own pool, blocks have to
+ * be freed by the thread that allocated them.
+ */
+class Pool {
+public:
+    struct Stats {
+        std::size_t allocations;
+        std::size_t live;
+        std::size_t peak;
+        std::size_t chunks;
+    };
+
+    static void* allocate(std::size_t size);
+    static void deallocate(void* p, std::size_t size);
+    static Stats getStats();
+};
+
+/**
+ * Allocator drawing from the ::Pool, for use with std::allocate_shared.
+ */
+template<class T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+
+    PoolAllocator() {}
+
+    template<class U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(std::size_t n)
+    {
+        if(n == 1)
+            return static_cast<T*>(Pool::allocate(sizeof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        if(n == 1)
+            Pool::deallocate(p, sizeof(T));
+        else
+            ::operator delete(p);
+    }
+};
+
+template<class T, class U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+    return true;
+}
+
+template<class T, class U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+    return false;
+}
+
+#endif // _NOTENGLISH_POOL_H_INCLUDE_GUARD
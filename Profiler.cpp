@@ -0,0 +1,300 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include <signal.h>
+#include <sys/time.h>
+#include <time.h>
+
+namespace Profiler {
+
+    volatile int line = 0;
+    bool active = false;
+    volatile bool needs_spare = false;
+
+    namespace {
+
+        const long interval_us = 1000;
+
+        struct Frame {
+            const std::string* function;
+            // Where the function is, only valid for the callers (the
+            // innermost call is at Profiler::line)
+            int line;
+        };
+
+        // Deeper calls are recorded as the deepest one kept
+        const std::size_t max_depth = 512;
+        Frame stack[max_depth];
+        // The number of calls, the program itself is the first one
+        volatile std::size_t depth = 0;
+
+        // A sample is a header (with the number of frames as line) and
+        // its frames, outermost first. They are appended by the signal
+        // handler to the last of a list of chunks. The handler must not
+        // allocate: it moves on to a spare chunk, and the program makes the
+        // next one (see Profiler::addSpare).
+        const std::size_t chunk_size = 1 << 14;
+        const std::size_t max_chunks = 256;
+        Frame* chunks[max_chunks];
+        // The frames used in each chunk but the last one
+        std::size_t ends[max_chunks];
+        volatile std::size_t chunk_count = 0;
+        // The frames used in the last chunk
+        volatile std::size_t used = 0;
+        Frame* volatile spare = nullptr;
+        volatile std::size_t dropped = 0;
+
+        std::unordered_map<const std::string*, std::uint64_t> calls;
+
+        struct sigaction previous;
+
+        void sample(int)
+        {
+            const std::size_t d = depth;
+            const std::size_t n = std::min(d, max_depth);
+            if(n == 0)
+                return;
+            if(chunk_size - used < n + 1) {
+                Frame* const next = spare;
+                if(!next) {
+                    dropped = dropped + 1;
+                    needs_spare = true;
+                    return;
+                }
+                const std::size_t c = chunk_count;
+                ends[c - 1] = used;
+                chunks[c] = next;
+                spare = nullptr;
+                used = 0;
+                chunk_count = c + 1;
+                needs_spare = c + 1 < max_chunks;
+            }
+            Frame* s = chunks[chunk_count - 1] + used;
+            s[0].function = nullptr;
+            s[0].line = static_cast<int>(n);
+            for(std::size_t i = 0; i < n; ++i)
+                s[i + 1] = stack[i];
+            if(d <= max_depth)
+                s[n].line = line;
+            used = used + n + 1;
+        }
+
+        const std::string program = "program";
+
+        const std::string& name(const std::string* function)
+        {
+            return function ? *function : program;
+        }
+
+        struct Times {
+            std::uint64_t inclusive;
+            std::uint64_t exclusive;
+
+            Times()
+                : inclusive(0), exclusive(0) {}
+        };
+
+        double cpuTime()
+        {
+            struct timespec t;
+            ::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+            return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+        }
+
+        double started = 0;
+
+        template<class Key>
+        std::vector<std::pair<Key, Times> > byTime(const std::map<Key, Times>& times)
+        {
+            std::vector<std::pair<Key, Times> > result(times.begin(), times.end());
+            std::stable_sort(result.begin(), result.end(),
+                [](const std::pair<Key, Times>& a, const std::pair<Key, Times>& b) {
+                    return a.second.inclusive > b.second.inclusive
+                        || (a.second.inclusive == b.second.inclusive
+                            && a.second.exclusive > b.second.exclusive);
+                });
+            return result;
+        }
+    }
+
+    void addSpare()
+    {
+        // Cleared first: the handler may take the spare right away and ask
+        // for the next one
+        needs_spare = false;
+        if(!spare && chunk_count < max_chunks)
+            spare = new Frame[chunk_size];
+    }
+
+    Call::Call(const std::string* function)
+        : caller(line), pushed(active)
+    {
+        if(!pushed)
+            return;
+        if(needs_spare)
+            addSpare();
+        const std::size_t d = depth;
+        if(d - 1 < max_depth)
+            stack[d - 1].line = caller;
+        if(d < max_depth) {
+            stack[d].function = function;
+            stack[d].line = 0;
+        }
+        // The frame is complete before the handler may look at it
+        std::atomic_signal_fence(std::memory_order_release);
+        depth = d + 1;
+        ++calls[function];
+    }
+
+    void Call::replace(const std::string* function)
+    {
+        if(!pushed)
+            return;
+        if(depth - 1 < max_depth)
+            stack[depth - 1].function = function;
+        ++calls[function];
+    }
+
+    Call::~Call()
+    {
+        if(pushed) {
+            depth = depth - 1;
+            std::atomic_signal_fence(std::memory_order_release);
+            line = caller;
+        }
+    }
+
+    Session::Session(std::ostream& o, const std::string& path)
+        : out(o), folded_path(path)
+    {
+        chunks[0] = new Frame[chunk_size];
+        chunk_count = 1;
+        used = 0;
+        spare = new Frame[chunk_size];
+        needs_spare = false;
+        dropped = 0;
+        calls.clear();
+        stack[0].function = nullptr;
+        stack[0].line = 0;
+        depth = 1;
+        active = true;
+        ++calls[nullptr];
+
+        struct sigaction action;
+        action.sa_handler = sample;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        ::sigaction(SIGPROF, &action, &previous);
+        struct itimerval timer;
+        timer.it_interval.tv_sec = 0;
+        timer.it_interval.tv_usec = interval_us;
+        timer.it_value = timer.it_interval;
+        started = cpuTime();
+        ::setitimer(ITIMER_PROF, &timer, nullptr);
+    }
+
+    Session::~Session()
+    {
+        struct itimerval timer = {};
+        ::setitimer(ITIMER_PROF, &timer, nullptr);
+        ::sigaction(SIGPROF, &previous, nullptr);
+        const double total = cpuTime() - started;
+        active = false;
+        depth = 0;
+
+        std::map<std::string, std::uint64_t> folded;
+        std::map<std::string, Times> functions;
+        std::map<int, Times> lines;
+        std::size_t count = 0;
+        std::vector<const std::string*> seen_functions;
+        std::vector<int> seen_lines;
+        ends[chunk_count - 1] = used;
+        for(std::size_t c = 0; c < chunk_count; ++c) {
+            for(std::size_t i = 0; i < ends[c]; i += chunks[c][i].line + 1) {
+                const Frame* frames = chunks[c] + i + 1;
+                const std::size_t n = chunks[c][i].line;
+                ++count;
+                std::string path;
+                seen_functions.clear();
+                seen_lines.clear();
+                for(std::size_t f = 0; f < n; ++f) {
+                    const std::string& function = name(frames[f].function);
+                    if(f != 0)
+                        path += ';';
+                    path += function + ':' + std::to_string(frames[f].line);
+                    // Recursion counts once for the inclusive times
+                    if(std::find_if(seen_functions.begin(), seen_functions.end(),
+                           [&](const std::string* s) { return name(s) == function; })
+                       == seen_functions.end()) {
+                        seen_functions.push_back(frames[f].function);
+                        ++functions[function].inclusive;
+                    }
+                    if(std::find(seen_lines.begin(), seen_lines.end(), frames[f].line)
+                       == seen_lines.end()) {
+                        seen_lines.push_back(frames[f].line);
+                        ++lines[frames[f].line].inclusive;
+                    }
+                }
+                ++folded[path];
+                ++functions[name(frames[n - 1].function)].exclusive;
+                ++lines[frames[n - 1].line].exclusive;
+            }
+        }
+        for(std::size_t c = 0; c < chunk_count; ++c)
+            delete[] chunks[c];
+        chunk_count = 0;
+        delete[] spare;
+        spare = nullptr;
+        needs_spare = false;
+
+        std::map<std::string, std::uint64_t> call_counts;
+        for(const auto& c : calls)
+            call_counts[name(c.first)] += c.second;
+        for(const auto& c : call_counts)
+            functions[c.first];
+
+        if(!folded_path.empty()) {
+            std::ofstream file(folded_path.c_str());
+            for(const auto& s : folded)
+                file << s.first << ' ' << s.second << '\n';
+            if(!file)
+                out << "could not write the profile to \"" << folded_path << "\"\n";
+        }
+
+        const std::ios::fmtflags flags = out.flags();
+        const std::streamsize precision = out.precision();
+        // The timer only fires as often as the kernel ticks, which may be
+        // less often than asked for, the samples share the time measured
+        const double per_sample = count ? total / (count + dropped) : 0;
+        auto ms = [per_sample](std::uint64_t samples) { return samples * per_sample; };
+        out << "profile: " << count << " samples in " << std::fixed << std::setprecision(1)
+            << total << " ms of CPU time";
+        if(dropped)
+            out << " (" << dropped << " more dropped)";
+        out << "\n\n" << std::left << std::setw(24) << "function" << std::right
+            << std::setw(12) << "calls" << std::setw(16) << "inclusive ms"
+            << std::setw(16) << "exclusive ms" << '\n';
+        for(const auto& f : byTime(functions)) {
+            out << std::left << std::setw(24) << f.first << std::right
+                << std::setw(12) << call_counts[f.first]
+                << std::setw(16) << ms(f.second.inclusive)
+                << std::setw(16) << ms(f.second.exclusive) << '\n';
+        }
+        out << '\n' << std::setw(8) << "line" << std::setw(16) << "inclusive ms"
+            << std::setw(16) << "exclusive ms" << '\n';
+        for(const auto& l : byTime(lines)) {
+            out << std::setw(8) << l.first << std::setw(16) << ms(l.second.inclusive)
+                << std::setw(16) << ms(l.second.exclusive) << '\n';
+        }
+        out.flags(flags);
+        out.precision(precision);
+        out.flush();
+    }
+}
@@ -0,0 +1,89 @@
+/**
+ * @file Profiler.h A sampling profiler of programs run on the syntax tree.
+ * A profiling timer interrupts the program every millisecond of CPU time
+ * (or every tick of the kernel, if those are further apart) and records
+ * where it is: the line of the statement being run and the calls of
+ * user-defined functions leading to it. Keeping track of that
+ * costs the interpreter a store per statement and call.
+ */
+#ifndef _NOTENGLISH_PROFILER_H_INCLUDE_GUARD
+#define _NOTENGLISH_PROFILER_H_INCLUDE_GUARD
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+namespace Profiler {
+
+    /**
+     * The line of the statement being run, in the innermost call.
+     */
+    extern volatile int line;
+    // Whether calls are being recorded
+    extern bool active;
+    // Whether the samples took their spare memory, the program makes the
+    // next one as the handler of the timer must not
+    extern volatile bool needs_spare;
+
+    /**
+     * Makes the memory the next samples go to once the current one is full.
+     */
+    void addSpare();
+
+    /**
+     * Called before running the statement on line \a l. Only stored while
+     * profiling, so threads running programs side by side (see
+     * ::BatchRunner) do not all write to it.
+     */
+    inline void at(int l)
+    {
+        if(active) {
+            line = l;
+            if(needs_spare)
+                addSpare();
+        }
+    }
+
+    /**
+     * Records a call of a user-defined function for as long as it exists.
+     * The line of the caller is restored afterwards.
+     */
+    class Call {
+        int caller;
+        bool pushed;
+    public:
+        /**
+         * @param function the name of the function, nullptr for the program
+         */
+        explicit Call(const std::string* function);
+        /**
+         * Replaces the function, when a tail call reuses the call.
+         */
+        void replace(const std::string* function);
+        ~Call();
+        Call(const Call&) = delete;
+        Call& operator=(const Call&) = delete;
+    };
+
+    /**
+     * Profiles the program for as long as it exists, and reports on it
+     * once that is done: the time spent in each function and on each line
+     * (with and without the calls made from there) is printed to \a out,
+     * the sampled stacks are written to \a folded_path in the folded
+     * format of flame graphs ("program:3;Fib:7;Fib:7 42").
+     *
+     * Function names are only looked at in the report, so the syntax tree
+     * has to outlive the session.
+     */
+    class Session {
+        std::ostream& out;
+        std::string folded_path;
+    public:
+        Session(std::ostream& out, const std::string& folded_path);
+        ~Session();
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+    };
+}
+
+#endif // _NOTENGLISH_PROFILER_H_INCLUDE_GUARD
@@ -0,0 +1,307 @@
+#include "Resolver.h"
+#include "Ast.h"
+#include <algorithm>
+
+Resolver::Resolver(DataHandler& d)
+    : data(d), scopes(), written(d.getConstantNames().size(), false), missing(),
+      shadowing(), stale(), resolving(nullptr), streaming(false), bodies(0), unbound(false)
+{
+    // The bottom scope holds the built-in constants
+    enter(data.getConstantNames());
+}
+
+void Resolver::resolve(Ast::Block& program)
+{
+    program.resolve(*this);
+    data.setDynamicNames(unbound);
+}
+
+void Resolver::resolveBody(const Impl& impl)
+{
+    ++bodies;
+    impl.first->resolveBody(*this, *impl.second);
+    --bodies;
+}
+
+void Resolver::beginStream()
+{
+    streaming = true;
+    written.assign(written.size(), true);
+    enter();
+}
+
+const SlotNames& Resolver::resolveStatement(Ast::Node& statement)
+{
+    statement.resolve(*this);
+    while(!scopes.back().impls.empty() || !stale.empty()) {
+        std::vector<Impl> impls;
+        impls.swap(scopes.back().impls);
+        for(const Impl& impl : stale) {
+            if(std::find(impls.begin(), impls.end(), impl) == impls.end())
+                impls.push_back(impl);
+        }
+        stale.clear();
+        for(const Impl& impl : impls) {
+            resolving = &impl;
+            resolveBody(impl);
+        }
+        resolving = nullptr;
+    }
+    // The bodies missing a name may find it in a later statement
+    data.setDynamicNames(unbound || !missing.empty());
+    return scopes.back().names;
+}
+
+void Resolver::enter(const std::vector<std::string>& args)
+{
+    scopes.push_back(LexicalScope());
+    for(const std::string& arg : args)
+        declareVar(arg);
+}
+
+SlotNames Resolver::leave()
+{
+    // Resolving a body may schedule more bodies (even in this scope)
+    while(!scopes.back().impls.empty()) {
+        std::vector<Impl> impls;
+        impls.swap(scopes.back().impls);
+        for(const Impl& impl : impls)
+            resolveBody(impl);
+    }
+    SlotNames names;
+    names.swap(scopes.back().names);
+    scopes.pop_back();
+    return names;
+}
+
+std::size_t Resolver::declareVar(const std::string& name)
+{
+    std::map<std::string, std::size_t>& vars = scopes.back().vars;
+    auto it = vars.find(name);
+    if(it != vars.end())
+        return it->second;
+    const std::size_t slot = vars.size();
+    vars[name] = slot;
+    scopes.back().names.push_back(name);
+    // Bodies resolved early which missed the name have to see it
+    if(streaming && scopes.size() == 2) {
+        declared(missing, name);
+        declared(shadowing, name);
+    }
+    return slot;
+}
+
+void Resolver::miss(std::map<std::string, std::vector<Impl> >& misses,
+                    const std::string& name)
+{
+    std::vector<Impl>& impls = misses[name];
+    if(std::find(impls.begin(), impls.end(), *resolving) == impls.end())
+        impls.push_back(*resolving);
+}
+
+void Resolver::declared(std::map<std::string, std::vector<Impl> >& misses,
+                        const std::string& name)
+{
+    auto it = misses.find(name);
+    if(it != misses.end()) {
+        stale.insert(stale.end(), it->second.begin(), it->second.end());
+        misses.erase(it);
+    }
+}
+
+void Resolver::declareFunc(const std::string& name, const std::vector<std::string>& args)
+{
+    scopes.back().funcs[name] = &args;
+}
+
+Binding Resolver::lookup(const std::string& name, bool outer_only)
+{
+    int depth = outer_only ? 1 : 0;
+    for(auto it = scopes.rbegin() + depth; it != scopes.rend(); ++it, ++depth) {
+        auto var = it->vars.find(name);
+        if(var != it->vars.end())
+            return Binding(depth, var->second);
+    }
+    // Left to be looked up among the variables of the callers, unless this
+    // only checked what a declaration shadows (which a streamed program may
+    // still declare)
+    if(outer_only) {
+        if(resolving)
+            miss(shadowing, name);
+        return Binding();
+    }
+    if(resolving)
+        miss(missing, name);
+    else if(bodies)
+        unbound = true;
+    return Binding();
+}
+
+int Resolver::implement(const std::string& name, Ast::FuncImpl* impl)
+{
+    int depth = 0;
+    for(auto it = scopes.rbegin(); it != scopes.rend(); ++it, ++depth) {
+        auto func = it->funcs.find(name);
+        if(func != it->funcs.end()) {
+            it->impls.push_back(Impl(impl, func->second));
+            return depth;
+        }
+    }
+    return -1;
+}
+
+bool Resolver::isConstant(const Binding& b) const
+{
+    return b.resolved() && static_cast<std::size_t>(b.depth) + 1 == scopes.size();
+}
+
+void Resolver::writeConstant(std::size_t slot)
+{
+    written[slot] = true;
+}
+
+// Resolving of the Ast nodes
+
+namespace Ast {
+
+    void Block::resolveStatements(Resolver& r)
+    {
+        for(auto& n : stmnts)
+            n->resolve(r);
+    }
+
+    void Block::resolve(Resolver& r)
+    {
+        r.enter();
+        resolveStatements(r);
+        names = r.leave();
+    }
+
+    void Block::resolveFunction(Resolver& r, const std::vector<std::string>& args)
+    {
+        r.enter(args);
+        resolveStatements(r);
+        names = r.leave();
+        markTail(0);
+    }
+
+    void Block::markTail(int scopes)
+    {
+        if(!stmnts.empty())
+            stmnts.back()->markTail(scopes + 1);
+    }
+
+    void Expression::resolve(Resolver& r)
+    {
+        left->resolve(r);
+        if(right)
+            right->resolve(r);
+    }
+
+    void Expression::resolveArg(Resolver& r)
+    {
+        if(right)
+            resolve(r);
+        else
+            left->resolveArg(r);
+    }
+
+    void UnaryOp::resolve(Resolver& r)
+    {
+        sub->resolve(r);
+    }
+
+    void UnaryOp::resolveArg(Resolver& r)
+    {
+        if(op == '-')
+            resolve(r);
+        else
+            sub->resolveArg(r);
+    }
+
+    void Condition::resolve(Resolver& r)
+    {
+        left->resolve(r);
+        right->resolve(r);
+    }
+
+    void Literal::resolve(Resolver& r)
+    {
+
+    }
+
+    void FunctionCall::resolve(Resolver& r)
+    {
+        // Only user-defined functions could change their arguments
+        const bool sys = data->findSysFunc(name);
+        for(auto& arg : args) {
+            if(sys)
+                arg->resolve(r);
+            else
+                arg->resolveArg(r);
+        }
+    }
+
+    void Assignment::resolve(Resolver& r)
+    {
+        binding = r.lookup(name);
+        if(r.isConstant(binding))
+            r.writeConstant(binding.slot);
+        value->resolve(r);
+    }
+
+    void VarDeclaration::resolve(Resolver& r)
+    {
+        shadowed = r.lookup(name, true);
+        binding = Binding(0, r.declareVar(name));
+    }
+
+    void FuncDeclaration::resolve(Resolver& r)
+    {
+        r.declareFunc(name, args);
+    }
+
+    void FuncImpl::resolve(Resolver& r)
+    {
+        home = r.implement(name, this);
+    }
+
+    void FuncImpl::resolveBody(Resolver& r, const std::vector<std::string>& args)
+    {
+        body->resolveFunction(r, args);
+    }
+
+    void VarNode::resolve(Resolver& r)
+    {
+        binding = r.lookup(name);
+        builtin = r.isConstant(binding);
+    }
+
+    void VarNode::resolveArg(Resolver& r)
+    {
+        resolve(r);
+        if(builtin)
+            r.writeConstant(binding.slot);
+    }
+
+    void IfStatement::resolve(Resolver& r)
+    {
+        condition->resolve(r);
+        body_if->resolve(r);
+        if(body_else)
+            body_else->resolve(r);
+    }
+
+    void IfStatement::markTail(int scopes)
+    {
+        body_if->markTail(scopes);
+        if(body_else)
+            body_else->markTail(scopes);
+    }
+
+    void WhileStatement::resolve(Resolver& r)
+    {
+        condition->resolve(r);
+        body->resolve(r);
+    }
+}
@@ -0,0 +1,158 @@
+#ifndef _NOTENGLISH_RESOLVER_H_INCLUDE_GUARD
+#define _NOTENGLISH_RESOLVER_H_INCLUDE_GUARD
+
+#include <map>
+#include <string>
+#include <vector>
+#include "DataHandler.h"
+
+namespace Ast {
+    class Node;
+    class Block;
+    class FuncImpl;
+}
+
+/**
+ * Binds every variable name in the program to a ::Binding, so that no name
+ * has to be looked up while executing. The actual walk over the tree is
+ * done by Ast::Node::resolve, the ::Resolver keeps the lexical scopes.
+ *
+ * Names are bound in program order, each variable declared in a block owns
+ * a slot of that block's ::Scope. Function bodies are resolved at the end of
+ * the block their function is declared in, so that they can use everything
+ * declared in that block; whether a variable has been declared by the time
+ * it is used is decided at runtime by its slot being empty.
+ *
+ * A name that is not declared in any enclosing scope is left unbound, it
+ * is looked up by name among the variables of the callers when it is used
+ * (see DataHandler::getVar). The ::DataHandler is told whether a function
+ * does so, so that tail calls keep the scopes of the caller.
+ *
+ * It also notes which built-in constants could be changed by the program,
+ * for the ::Optimizer.
+ *
+ * A program run while it is read (see ::Streamer) is resolved a statement
+ * at a time instead, its scope is never complete: function bodies are
+ * resolved right away and again whenever a name they could not find, or
+ * that a declaration of theirs could shadow, is declared in the program
+ * scope.
+ */
+class Resolver {
+    // A function implementation waiting to be resolved, with its arguments
+    typedef std::pair<Ast::FuncImpl*, const std::vector<std::string>*> Impl;
+
+    struct LexicalScope {
+        std::map<std::string, std::size_t> vars;
+        SlotNames names;
+        std::map<std::string, const std::vector<std::string>*> funcs;
+        std::vector<Impl> impls;
+    };
+
+    DataHandler& data;
+    std::vector<LexicalScope> scopes;
+    // Per built-in constant, whether the program may change it
+    std::vector<bool> written;
+    // For streamed programs: the bodies resolved early per name they could
+    // not find, per name a declaration of theirs could shadow but did not
+    // find, the ones to resolve again and the one being resolved
+    std::map<std::string, std::vector<Impl> > missing;
+    std::map<std::string, std::vector<Impl> > shadowing;
+    std::vector<Impl> stale;
+    const Impl* resolving;
+    bool streaming;
+    // The number of function bodies being resolved, and whether a name in
+    // one could not be bound
+    int bodies;
+    bool unbound;
+
+    /**
+     * Resolves the body of \a impl.
+     */
+    void resolveBody(const Impl& impl);
+
+    /**
+     * Notes that the body being resolved has to be resolved again once
+     * \a name is declared in the program scope.
+     */
+    void miss(std::map<std::string, std::vector<Impl> >& misses,
+              const std::string& name);
+
+    /**
+     * Schedules the bodies in \a misses waiting for \a name to be resolved
+     * again.
+     */
+    void declared(std::map<std::string, std::vector<Impl> >& misses,
+                  const std::string& name);
+public:
+    Resolver(DataHandler& data);
+
+    /**
+     * Resolves the main program.
+     */
+    void resolve(Ast::Block& program);
+
+    /**
+     * Starts resolving a streamed program by opening its scope. Any
+     * built-in constant may be changed by a statement still to come.
+     */
+    void beginStream();
+
+    /**
+     * Resolves a statement in the scope of a streamed program, along with
+     * the function bodies waiting for it.
+     * @return the names of the slots of the program scope, valid until the
+     *  next statement is resolved
+     */
+    const SlotNames& resolveStatement(Ast::Node& statement);
+
+    /**
+     * Opens a new scope, with the given names in its first slots.
+     */
+    void enter(const std::vector<std::string>& args = std::vector<std::string>());
+    /**
+     * Resolves the pending function bodies and closes the current scope.
+     * @return the names of the slots of the scope
+     */
+    SlotNames leave();
+
+    /**
+     * Declares a variable in the current scope.
+     * @return the slot of the variable
+     */
+    std::size_t declareVar(const std::string& name);
+    void declareFunc(const std::string& name, const std::vector<std::string>& args);
+
+    /**
+     * @param outer_only only look in the enclosing scopes (for what a
+     *  declaration shadows), a name not found there is no name to look up
+     *  among the callers' variables
+     * @return the ::Binding of \a name, unresolved if it is not declared
+     */
+    Binding lookup(const std::string& name, bool outer_only = false);
+
+    /**
+     * Finds the scope declaring the function \a name and schedules \a impl to
+     * be resolved at the end of that scope.
+     * @return the depth of the declaring scope, -1 if there is none
+     */
+    int implement(const std::string& name, Ast::FuncImpl* impl);
+
+    /**
+     * @return whether \a b refers to a built-in constant (in the bottom
+     *  scope)
+     */
+    bool isConstant(const Binding& b) const;
+
+    /**
+     * Notes that the built-in constant in \a slot may be changed, by an
+     * assignment or by passing it to a user-defined function.
+     */
+    void writeConstant(std::size_t slot);
+
+    bool isWritten(std::size_t slot) const
+    {
+        return written[slot];
+    }
+};
+
+#endif // _NOTENGLISH_RESOLVER_H_INCLUDE_GUARD
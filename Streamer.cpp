@@ -0,0 +1,47 @@
+#include "Streamer.h"
+#include "Optimizer.h"
+#include "TokenHandler.h"
+
+Streamer::Streamer(const std::string& filename, DataHandler& d, bool optimize)
+    : data(d), lexer(filename), resolver(d), optimize(optimize), names(), arenas(),
+      kept()
+{
+
+}
+
+void Streamer::run()
+{
+    // The scope of the program, which grows with its sentences
+    resolver.beginStream();
+    data.addScope(names);
+    bool stopped = false;
+    while(!stopped) {
+        const TokenStream tokens = lexer.nextSentence();
+        if(tokens.size() == 0)
+            break;
+        std::unique_ptr<Arena> arena(new Arena());
+        Parser parser(tokens, data, *arena);
+        std::deque<Ast::NodePtr> statements;
+        {
+            std::unique_ptr<Ast::Block> sentence(parser.run());
+            statements = sentence->takeStatements();
+        }
+        stopped = parser.hasStopped();
+        for(Ast::NodePtr& statement : statements) {
+            const SlotNames& declared = resolver.resolveStatement(*statement);
+            names.insert(names.end(), declared.begin() + names.size(), declared.end());
+            data.growScope(names.size());
+            if(optimize)
+                Optimizer(data, resolver, *arena).fold(statement);
+            Profiler::at(statement->getLine());
+            statement->execute();
+        }
+        if(parser.hasFunctions()) {
+            for(Ast::NodePtr& statement : statements)
+                kept.push_back(std::move(statement));
+            arenas.push_back(std::move(arena));
+        }
+        // Otherwise the nodes are gone here, before their arena
+    }
+    data.popScope();
+}
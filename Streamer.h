@@ -0,0 +1,47 @@
+/**
+ * @file Streamer.h Runs a program while it is being read.
+ */
+#ifndef _NOTENGLISH_STREAMER_H_INCLUDE_GUARD
+#define _NOTENGLISH_STREAMER_H_INCLUDE_GUARD
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Arena.h"
+#include "Ast.h"
+#include "Resolver.h"
+#include "TokenStream.h"
+
+/**
+ * Lexes, parses and runs a program one top-level sentence at a time (see
+ * Lexer::nextSentence), on the syntax tree. The first sentences run before
+ * the rest of the program is read, and a sentence is gone once it has run:
+ * only those declaring or implementing functions are kept, since the
+ * functions live on. So memory does not grow with the length of the
+ * program.
+ *
+ * A function body sees the whole program scope, like it does when the
+ * program is read at once (see Resolver::resolveStatement). The built-in
+ * constants are never folded, as a sentence still to come could change
+ * them.
+ */
+class Streamer {
+    DataHandler& data;
+    Lexer lexer;
+    Resolver resolver;
+    bool optimize;
+    // The variables of the program scope, which grow with its sentences
+    SlotNames names;
+    // The kept sentences and the arenas of their nodes
+    std::vector<std::unique_ptr<Arena> > arenas;
+    std::vector<Ast::NodePtr> kept;
+public:
+    /**
+     * @param filename the program, "-" for the standard input
+     */
+    Streamer(const std::string& filename, DataHandler& d, bool optimize);
+
+    void run();
+};
+
+#endif // _NOTENGLISH_STREAMER_H_INCLUDE_GUARD
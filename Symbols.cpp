@@ -0,0 +1,45 @@
+#include "Symbols.h"
+#include <atomic>
+
+namespace Symbols {
+
+    namespace {
+
+        // The entries of all tables, for Symbols::count
+        std::atomic<std::size_t> entries(0);
+    }
+
+    Table::~Table()
+    {
+        entries.fetch_sub(size(), std::memory_order_relaxed);
+    }
+
+    const std::string& Table::intern(boost::string_view name)
+    {
+        auto it = name_index.find(name);
+        if(it != name_index.end())
+            return *it->second;
+        names.emplace_back(name.data(), name.size());
+        const std::string& copy = names.back();
+        name_index.emplace(boost::string_view(copy), &copy);
+        entries.fetch_add(1, std::memory_order_relaxed);
+        return copy;
+    }
+
+    Value Table::literal(boost::string_view text)
+    {
+        auto it = literal_index.find(text);
+        if(it != literal_index.end())
+            return *it->second;
+        literals.emplace_back(text.data(), text.size());
+        const Value& copy = literals.back();
+        literal_index.emplace(boost::string_view(copy.stringData(), copy.stringSize()), &copy);
+        entries.fetch_add(1, std::memory_order_relaxed);
+        return copy;
+    }
+
+    std::size_t count()
+    {
+        return entries.load(std::memory_order_relaxed);
+    }
+}
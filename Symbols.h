@@ -0,0 +1,64 @@
+/**
+ * @file Symbols.h The tables of the names and string literals of programs.
+ * Each name is kept once per table, and the syntax tree refers to it
+ * instead of holding a copy in every node that uses it. Every ::Arena has
+ * a table, so the names of a program go when its nodes do.
+ */
+#ifndef _NOTENGLISH_SYMBOLS_H_INCLUDE_GUARD
+#define _NOTENGLISH_SYMBOLS_H_INCLUDE_GUARD
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <boost/functional/hash.hpp>
+#include <boost/utility/string_view.hpp>
+#include "Value.h"
+
+namespace Symbols {
+
+    /**
+     * The names and string literals used by the nodes of one ::Arena. A
+     * ::Table belongs to the thread filling its ::Arena.
+     */
+    class Table {
+        // The keys are views of the kept copies, which never move
+        std::deque<std::string> names;
+        std::unordered_map<boost::string_view, const std::string*,
+                           boost::hash<boost::string_view> > name_index;
+        std::deque<Value> literals;
+        std::unordered_map<boost::string_view, const Value*,
+                           boost::hash<boost::string_view> > literal_index;
+    public:
+        Table() = default;
+        ~Table();
+        Table(const Table&) = delete;
+        Table& operator=(const Table&) = delete;
+
+        /**
+         * @return the one copy of \a name in this table, which lives as
+         *  long as the table does
+         */
+        const std::string& intern(boost::string_view name);
+
+        /**
+         * @return the value of the string literal \a text, all literals
+         *  of this table with the same text share their characters
+         */
+        Value literal(boost::string_view text);
+
+        /**
+         * @return the number of names and literals kept
+         */
+        std::size_t size() const
+        {
+            return names.size() + literals.size();
+        }
+    };
+
+    /**
+     * @return the number of names and literals kept by all tables alive
+     */
+    std::size_t count();
+}
+
+#endif // _NOTENGLISH_SYMBOLS_H_INCLUDE_GUARD
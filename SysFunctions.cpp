@@ -1,44 +1,54 @@
 #include "SysFunctions.h"
+#include "DataHandler.h"
+#include "Output.h"
 #include <boost/lexical_cast.hpp>
 #include <iostream>
 
 namespace sys {
-    VarPtr get_input(arg_t& args)
+    bool standard_input(std::string& line)
     {
+        return static_cast<bool>(std::getline(std::cin, line));
+    }
+
+    Value get_input(DataHandler& data, arg_t& args)
+    {
+        // The prompt has to be seen first
+        data.getOutput().flush();
         std::string line;
-        std::getline(std::cin, line);
-        return VarPtr(new Variable(line));
+        if(!data.readInput(line))
+            line.clear();
+        return Value(line);
     }
 
-    VarPtr display(arg_t& args)
+    Value display(DataHandler& data, arg_t& args)
     {
+        Output::Stream& out = data.getOutput();
         for(auto& arg : args) {
-            switch(arg->type) {
-                case Variable::Type::String:
-                    std::cout << arg->getValue<Variable::StringType>();
+            switch(arg->getType()) {
+                case Value::Type::String:
+                    out.write(arg->stringData(), arg->stringSize());
                     break;
-                case Variable::Type::Number:
-                    std::cout << arg->getValue<Variable::NumberType>();
+                case Value::Type::Number:
+                    out.write(arg->number());
                     break;
                 default:
                     throw std::runtime_error("type not supported by display");
             }
         }
-        std::cout.flush();
-        return VarPtr(new Variable());
+        out.commit();
+        return Value();
     }
 
-    VarPtr to_number(arg_t& args)
+    Value to_number(DataHandler& data, arg_t& args)
     {
-        return VarPtr(new Variable(boost::lexical_cast<double>(
+        return Value(boost::lexical_cast<double>(
             args[0]->getValue<std::string>()
-        )));
+        ));
     }
 
-    VarPtr to_string(arg_t& args)
+    Value to_string(DataHandler& data, arg_t& args)
     {
-        return VarPtr(new Variable(boost::lexical_cast<std::string>(
-            args[0]->getValue<double>()
-        )));
+        char buf[Output::number_size];
+        return Value(buf, Output::format(args[0]->getValue<double>(), buf));
     }
 }
@@ -1,13 +1,29 @@
 #ifndef _SYSFUNCTIONS_GUARD
 #define _SYSFUNCTIONS_GUARD
 // Files needed for the system functions
+#include <functional>
+#include <string>
 #include <vector>
 #include "Variable.h"
 
+class DataHandler;
+
 namespace sys {
-    VarPtr get_input(arg_t& args);
-    VarPtr display(arg_t& args);
-    VarPtr to_number(arg_t& args);
-    VarPtr to_string(arg_t& args);
+    /**
+     * Reads a line of the input of a program into \a line (without the
+     * newline).
+     * @return false at the end of the input
+     */
+    typedef std::function<bool(std::string& line)> Input;
+
+    /**
+     * Reads a line of the standard input.
+     */
+    bool standard_input(std::string& line);
+
+    Value get_input(DataHandler& data, arg_t& args);
+    Value display(DataHandler& data, arg_t& args);
+    Value to_number(DataHandler& data, arg_t& args);
+    Value to_string(DataHandler& data, arg_t& args);
 }
 #endif // _SYSFUNCTIONS_GUARD
@@ -1,4 +1,5 @@
 #include "TokenHandler.h"
+#include <memory>
 #include <stdexcept>
 #include <sstream>
 #include <boost/lexical_cast.hpp>
@@ -14,9 +15,9 @@ void Parser::setupHandlers()
     handlers[TokenType::When] = &Parser::handleFuncImpl;
 }
 
-Parser::Parser(TokenStream& tokens, DataHandler& data)
-    : ts(tokens), current(), data_handler(data), handlers(),
-      program(new Ast::Block(&data))
+Parser::Parser(const TokenStream& tokens, DataHandler& data, Arena& a)
+    : ts(tokens), current(), data_handler(data), arena(a), handlers(),
+      block(nullptr), stopped(false), functions(0)
 {
     setupHandlers();
 }
@@ -24,40 +25,81 @@ Parser::Parser(TokenStream& tokens, DataHandler& data)
 Ast::Block* Parser::run()
 {
     current = ts.begin();
-    while(handleToken() && current != ts.end());
-    return program;
+    return parseBlock(false);
 }
 
-void Parser::skipOptional(TokenType type)
+Ast::Block* Parser::parseBlock(bool nested)
+{
+    Ast::Block* outer = block;
+    // Owned here until the block is complete, an error frees its nodes
+    std::unique_ptr<Ast::Block> result(new (arena) Ast::Block(&data_handler));
+    block = result.get();
+    while(current != ts.end()) {
+        if(nested && current->type == TokenType::BlockEnd)
+            break;
+        if(!handleToken()) {
+            // The rest of the block is ignored
+            if(nested) {
+                skipBlock();
+            } else {
+                current = ts.end();
+                stopped = true;
+            }
+            break;
+        }
+    }
+    if(nested && current == ts.end())
+        error("expecting \"That's all\" at the end of a block", (current - 1)->line);
+    block = outer;
+    return result.release();
+}
+
+void Parser::skipBlock()
+{
+    int nesting = 0;
+    for(; current != ts.end(); ++current) {
+        if(current->type == TokenType::BlockBegin)
+            ++nesting;
+        else if(current->type == TokenType::BlockEnd && nesting-- == 0)
+            return;
+    }
+}
+
+void Parser::advance()
 {
     ++current;
+    if(current == ts.end())
+        error("Unexpected end of program", (current - 1)->line);
+}
+
+void Parser::skipOptional(TokenType type)
+{
+    advance();
     if(current->type != type)
         --current;
 }
 
-void Parser::insert(const Token& t, int offset)
+const std::string& Parser::intern(const Token& t)
 {
-    current = ts.insert(current + offset, t);
-    current -= offset;
+    return arena.getSymbols().intern(ts.getText(t));
 }
 
-void Parser::readBlock(std::vector<Token>& tokens, TokenType begin)
+const Token& Parser::peek(std::ptrdiff_t offset) const
 {
-    ++current;
+    // Looking past the end gives a token no rule expects
+    static const Token none(TokenType::Unkown);
+    if(ts.end() - current <= offset)
+        return none;
+    return current[offset];
+}
+
+Ast::Block* Parser::readBlock(TokenType begin)
+{
+    advance();
     if(current->type != begin)
         error("expecting a 'then:' or perhaps 'do:' as a block beginning", current->line);
-
-    int to_find = 1;
-    while(to_find > 0) {
-        ++current;
-        if(current->type == TokenType::BlockEnd)
-            --to_find;
-        else if(current->type == TokenType::BlockBegin)
-            ++to_find;
-        tokens.push_back(*current);
-    }
-    // We read a TokenType::BlockEnd that we do not need(other ones are needed for nesting though)
-    tokens.pop_back();
+    advance();
+    return parseBlock(true);
 }
 
 
@@ -70,6 +112,11 @@ void Parser::handleUnexpectedToken()
 }
 
 bool Parser::handleToken() {
+    // The statement (if any) is attached to this block, nested ones are
+    // parsed in between
+    Ast::Block* const target = block;
+    const std::size_t count = target->size();
+    const int line = current->line;
     switch(current->type) {
         case TokenType::Begin:
         case TokenType::End:
@@ -86,67 +133,70 @@ bool Parser::handleToken() {
                 (handler->second)(this);
         }
     }
-    ++current;
+    if(target->size() != count)
+        target->back()->setLine(line);
+    advance();
     if(current->type != TokenType::Dot)
         error("sentences are usually ended with a dot", current->line);
+    // The dot may end the program
     ++current;
     return true;
 }
 
 void Parser::handleIdentifier()
 {
-    program->attach(handleFunctionCall(false));
+    block->attach(handleFunctionCall(false));
 }
 
 void Parser::handleFuncImpl()
 {
-    ++current;
+    advance();
     // Skip optional "calling"
     skipOptional(TokenType::Calling);
     // Expecting the name (id)
-    ++current;
+    advance();
     if(current->type != TokenType::Identifier)
         error("type identifier required in function impl.", current->line);
-    const std::string name = current->getValue<std::string>();
-    TokenStream tokens;
-    readBlock(tokens);
-    program->attach(new Ast::FuncImpl(
-        name, &data_handler, Parser(tokens, data_handler).run()
-    ));
+    const std::string& name = intern(*current);
+    Ast::Block* body = readBlock();
+    block->attach(new (arena) Ast::FuncImpl(name, &data_handler, body));
+    ++functions;
 }
 
 void Parser::handle_declaration() {
     skipOptional(TokenType::Article);
     // Expecting a type identifier (eg. "variable" or "function")
-    ++current;
+    advance();
     if(current->type != TokenType::Identifier)
         error("type identifier required in declaration", current->line);
-    const std::string type = current->getValue<std::string>();
+    const std::string type = ts.getString(*current);
     // Skip (optional) KnownAs token (eg. "called" or "labeled")
     skipOptional(TokenType::KnownAs);
     // Expecting an identifier now
-    ++current;
+    advance();
     if(current->type != TokenType::Identifier)
         return error("expecting a name on declaration", current->line);
-    const std::string name = current->getValue<std::string>();
+    const std::string& name = intern(*current);
 
     if(type == "variable")
-        return program->attach(new Ast::VarDeclaration(name, &data_handler));
+        return block->attach(new (arena) Ast::VarDeclaration(name, &data_handler));
     if(type == "function" || type == "subroutine" || type == "procedure") {
-// TODO (tim#1#): Fix memory leak (premature return in case of error)
-        Ast::FuncDeclaration* decl = new Ast::FuncDeclaration(name, &data_handler);
+        std::unique_ptr<Ast::FuncDeclaration> decl(
+            new (arena) Ast::FuncDeclaration(name, &data_handler));
+        ++functions;
         // Possibly read a On (With) token
-        if((current + 1)->type != TokenType::On)
-            return program->attach(decl);
-        current += 2; // Skip Token::On and move to next token
+        if(peek(1).type != TokenType::On)
+            return block->attach(decl.release());
+        // Skip Token::On and move to next token
+        ++current;
+        advance();
         // Read "arguments"
         if(current->type != TokenType::Argument)
             return error("expecting \"argument\" after on/with", current->line);
         // Read the actual arguments now
-        while((++current)->type == TokenType::Identifier)
-            decl->addArg(current->getValue<std::string>());
-        --current;
-        return program->attach(decl);
+        while(peek(1).type == TokenType::Identifier)
+            decl->addArg(ts.getString(*++current));
+        return block->attach(decl.release());
     }
     return error("incorrect type for object in declaration", current->line);
 
@@ -159,72 +209,64 @@ void Parser::handle_setvar() {
     skipOptional(TokenType::ValueOf);
     // Expecting a name OR an (optional) article
     skipOptional(TokenType::Article);
-    ++current;
+    advance();
     if(current->type != TokenType::Identifier)
         error("expecting a name that contains the value", current->line);
-    const std::string name = current->getValue<std::string>();
+    const std::string& name = intern(*current);
     // Expecting a to now
-    ++current;
+    advance();
     if(current->type != TokenType::To)
         error("expecting to after the name", current->line);
     // Now we need to read an expression and set the name with it
-    program->attach(new Ast::Assignment(name, &data_handler, expression()));
+    block->attach(new (arena) Ast::Assignment(name, &data_handler, expression()));
 }
 
 void Parser::handle_if() {
     // Read the condition first
-    Ast::Condition* if_cond = condition();
+    std::unique_ptr<Ast::Condition> if_cond(condition());
     // Read a block
-    std::vector<Token> tokens;
-    readBlock(tokens);
-    Ast::Block* if_body = Parser(tokens, data_handler).run(); 
+    std::unique_ptr<Ast::Block> if_body(readBlock());
     Ast::Block* else_body = nullptr;
     // Read a possible else
-    if((current + 2)->type == TokenType::Else) {
+    if(peek(2).type == TokenType::Else) {
         current += 2; // Skip the dot
-        std::vector<Token> tokens2;
-        readBlock(tokens2);
-        else_body = Parser(tokens2, data_handler).run();
+        else_body = readBlock();
     }
 
-    program->attach(new Ast::IfStatement(if_cond, if_body, else_body));
+    block->attach(new (arena) Ast::IfStatement(if_cond.release(), if_body.release(), else_body));
 }
 
 void Parser::handle_while() {
     // Read the condition first
-    Ast::Condition* cond = condition();
-    // Read the body tokens
-    std::vector<Token> tokens;
-    readBlock(tokens, TokenType::BlockBegin);
-    Ast::Block* body = Parser(tokens, data_handler).run();
-    program->attach(new Ast::WhileStatement(cond, body));
+    std::unique_ptr<Ast::Condition> cond(condition());
+    // Read the body
+    Ast::Block* body = readBlock(TokenType::BlockBegin);
+    block->attach(new (arena) Ast::WhileStatement(cond.release(), body, &data_handler));
 }
 
 Ast::FunctionCall* Parser::handleFunctionCall(bool in_expr)
 {
     // Get the function name
-    const std::string name = current->getValue<std::string>();
-    Ast::FunctionCall* call = new Ast::FunctionCall(name, &data_handler);
+    const std::string& name = intern(*current);
+    std::unique_ptr<Ast::FunctionCall> call(new (arena) Ast::FunctionCall(name, &data_handler));
     if(in_expr) {
         // If we don't find a TokenType::On now, we return the result
-        if((current + 1)->type != TokenType::On)
-            return call;
-        ++current;
+        if(peek(1).type != TokenType::On)
+            return call.release();
+        advance();
     } else {
         // If we find a TokenType::Dot, return the result
-        if((current + 1)->type == TokenType::Dot)
-            return call;
+        if(peek(1).type == TokenType::Dot)
+            return call.release();
     }
     // Read all arguments (separated by "and")
     while(true) {
         call->addArgument(expression());
-        ++current;
-        if(current->type != TokenType::Operator || current->getValue<char>() != '&') {
-            --current;
+        if(peek(1).type != TokenType::Operator || peek(1).getValue<char>() != '&')
             break;
-        }
+        ++current;
     }
-    return call;
+    return call.release();
 }
 // handlers(handle_*)
 // // // // // // // // //
@@ -236,35 +278,38 @@ Ast::FunctionCall* Parser::handleFunctionCall(bool in_expr)
 
 Ast::UnaryOp* Parser::primary()
 {
-    ++current;
+    advance();
     switch(current->type) {
-        case TokenType::String:
-            return new Ast::UnaryOp(new Ast::Literal(Variable(current->getValue<Variable::StringType>())));
+        case TokenType::String: {
+            const boost::string_view text = ts.getText(*current);
+            return new (arena) Ast::UnaryOp(new (arena) Ast::Literal(arena.getSymbols().literal(text)));
+        }
         case TokenType::Number:
-            return new Ast::UnaryOp(new Ast::Literal(Variable(current->getValue<Variable::NumberType>())));
+            return new (arena) Ast::UnaryOp(new (arena) Ast::Literal(Value(current->getValue<Value::NumberType>())));
         case TokenType::Article:
             // We actually expect another primary now
             // because we allow an optional article before a primary
             return primary();
         case TokenType::Identifier:
-            return new Ast::UnaryOp(new Ast::VarNode(current->getValue<std::string>(), &data_handler));
+            return new (arena) Ast::UnaryOp(new (arena) Ast::VarNode(intern(*current), &data_handler));
         case TokenType::FuncResult:
             skipOptional(TokenType::Of);
-            ++current;
-            if(current->type == TokenType::Identifier && current->getValue<std::string>() == "calling");
-                ++current;
-
-            return new Ast::UnaryOp(handleFunctionCall());
+            advance();
+            if(current->type == TokenType::Identifier && ts.getText(*current) == "calling");
+                advance();
+            if(current->type != TokenType::Identifier && current->type != TokenType::FuncName)
+                error("expecting the name of a function", current->line);
+            return new (arena) Ast::UnaryOp(handleFunctionCall());
         case TokenType::Operator: {
             char op = current->getValue<char>();
             if(op == '(') {
-                Ast::UnaryOp* uop = new Ast::UnaryOp(expression());
-                ++current;
+                std::unique_ptr<Ast::UnaryOp> uop(new (arena) Ast::UnaryOp(expression()));
+                advance();
                 if(current->getValue<char>() != ')')
                     error("expected ')' after '('", current->line);
-                return uop;
+                return uop.release();
             } else if(op == '-')
-                return new Ast::UnaryOp(primary(), op);
+                return new (arena) Ast::UnaryOp(primary(), op);
             else
                 error("unexpected operator in primary", current->line);
         }
@@ -275,38 +320,40 @@ Ast::UnaryOp* Parser::primary()
 }
 
 Ast::Expression* Parser::term() {
-    Ast::UnaryOp* left = primary();
-    ++current;
+    std::unique_ptr<Ast::UnaryOp> left(primary());
+    advance();
     if(current->type != TokenType::Operator) {
         --current;
-        return new Ast::Expression(left);
+        return new (arena) Ast::Expression(left.release());
     }
     const char op = current->getValue<char>();
     if(op != '*' && op != '/') {
         --current;
-        return new Ast::Expression(left);
+        return new (arena) Ast::Expression(left.release());
     }
-    return new Ast::Expression(left, term(), op);
+    Ast::Expression* right = term();
+    return new (arena) Ast::Expression(left.release(), right, op);
 }
 
 Ast::Expression* Parser::expression() {
-    Ast::Expression* left = term();
-    ++current;
+    std::unique_ptr<Ast::Expression> left(term());
+    advance();
     if(current->type != TokenType::Operator) {
         --current;
-        return left;
+        return left.release();
     }
     const char op = current->getValue<char>();
     if(op != '+' && op != '-') {
         --current;
-        return left;
+        return left.release();
     }
-    return new Ast::Expression(left, expression(), op);
+    Ast::Expression* right = expression();
+    return new (arena) Ast::Expression(left.release(), right, op);
 }
 
 Ast::Condition* Parser::condition_term() {
-    Ast::Expression* left = expression();
-    ++current;
+    std::unique_ptr<Ast::Expression> left(expression());
+    advance();
     if(current->type != TokenType::Operator)
         error("expecting operator in the condition", current->line);
 
@@ -314,21 +361,23 @@ Ast::Condition* Parser::condition_term() {
     if(op != '=' && op != '!' && op != '<' && op != '>')
         error("unsupported operator in the condition", current->line);
 
-    return new Ast::Condition(left, expression(), op);
+    Ast::Expression* right = expression();
+    return new (arena) Ast::Condition(left.release(), right, op);
 }
 
 Ast::Condition* Parser::condition()
 {
-    Ast::Condition* left = condition_term();
-    ++current;
+    std::unique_ptr<Ast::Condition> left(condition_term());
+    advance();
     if(current->type != TokenType::Operator) {
         --current;
-        return left;
+        return left.release();
     }
     const char op = current->getValue<char>();
     if(op != '&' && op != '|') {
         --current;
-        return left;
+        return left.release();
     }
-    return new Ast::Condition(left, condition(), op);
+    Ast::Condition* right = condition();
+    return new (arena) Ast::Condition(left.release(), right, op);
 }
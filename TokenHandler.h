@@ -8,17 +8,37 @@
 #include "Ast.h"
 
 /**
- * Creates an AST from a ::TokenStream.
+ * Creates an AST from a ::TokenStream in a single pass, nested blocks are
+ * parsed recursively. All nodes are allocated in the given ::Arena.
  */
 class Parser {
     typedef std::function<void(Parser*)> Handler;
     typedef std::map<TokenType, Handler> HandlerMap;
 
-    TokenStream& ts;
-    TokenStream::iterator current;
+    const TokenStream& ts;
+    TokenStream::const_iterator current;
     DataHandler& data_handler;
+    Arena& arena;
     HandlerMap handlers;
-    Ast::Block* program;
+    // The block being parsed
+    Ast::Block* block;
+    // Whether the program was stopped before the end of the tokens
+    bool stopped;
+    // The number of functions declared or implemented
+    std::size_t functions;
+
+    /**
+     * Moves current to the next ::Token, which the caller is about to
+     * read: a program ending there is cut short.
+     * @throw ParseError at the end of the ::TokenStream
+     */
+    void advance();
+
+    /**
+     * @return the name in the ::Token \a t, interned in the table of the
+     *  ::Arena (so it lives as long as the nodes using it)
+     */
+    const std::string& intern(const Token& t);
 
     /**
      * Gets a ::Token from the ::TokenStream but skips one optional token of
@@ -27,12 +47,29 @@ class Parser {
      */
     void skipOptional(TokenType type);
 
-    void readBlock(std::vector<Token>& tokens, TokenType begin = TokenType::BlockBegin);
+    /**
+     * Parses the statements of a block (up to the closing
+     * TokenType::BlockEnd, where current is left).
+     * @param nested false for the program itself, which ends with the
+     *  ::TokenStream
+     */
+    Ast::Block* parseBlock(bool nested);
+
+    /**
+     * Moves current to the end of the block it is in, skipping nested ones.
+     */
+    void skipBlock();
+
+    /**
+     * Reads a block beginning with a token of the given type.
+     */
+    Ast::Block* readBlock(TokenType begin = TokenType::BlockBegin);
 
     /**
-     * Insert a ::Token before current + offset.
+     * Looks ahead without moving current, the ::TokenStream is never
+     * changed.
      */
-    void insert(const Token& t, int offset = 1);
+    const Token& peek(std::ptrdiff_t offset) const;
 
     /**
      * Handles an unexpected token in Parser::handleToken.
@@ -62,7 +99,25 @@ class Parser {
 
     void setupHandlers();
 public:
-    Parser(TokenStream& tokens, DataHandler& data);
+    Parser(const TokenStream& tokens, DataHandler& data, Arena& a);
     Ast::Block* run();
+
+    /**
+     * @return whether the program ended early (by "Stop" or a token that
+     *  could not be read)
+     */
+    bool hasStopped() const
+    {
+        return stopped;
+    }
+
+    /**
+     * @return whether functions were declared or implemented, which live on
+     *  after their statement ran (see ::Streamer)
+     */
+    bool hasFunctions() const
+    {
+        return functions != 0;
+    }
 };
 #endif
@@ -2,141 +2,183 @@
 #define _TOKENSTREAM_GUARD
 
 #include "TokenStream.h"
+#include <algorithm>
+#include <cerrno>
 #include <iostream>
-#include <sstream>
 #include <stdexcept>
+#include <cctype>
+#include <cstdlib>
+#include <type_traits>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::is_pod<Token>::value && sizeof(Token) == 16,
+              "tokens are meant to be 16 byte PODs");
 
 // error handling functions
-void error(const std::string& msg, int line = 0)
+static thread_local std::ostream* error_log = nullptr;
+
+std::ostream* setErrorLog(std::ostream* log)
 {
-    if(line)
-        std::cerr << "Fatal Error: " << msg << " at line " << line << std::endl;
-    else
-        std::cerr << "Fatal Error: " << msg << std::endl;
-    throw std::runtime_error(msg);
+    std::ostream* const previous = error_log;
+    error_log = log;
+    return previous;
 }
 
-void TokenTable::add(TokenType t, const std::string& word)
+std::ostream& errorLog()
 {
-    table[word] = t;
+    return error_log ? *error_log : std::cerr;
 }
 
-TokenType TokenTable::operator[](const std::string& word)
+void error(const std::string& msg, int line = 0)
 {
-    return table[word];
+    std::ostream& out = errorLog();
+    if(line)
+        out << "Fatal Error: " << msg << " at line " << line << std::endl;
+    else
+        out << "Fatal Error: " << msg << std::endl;
+    throw ParseError(msg, line);
 }
 
-
 // Lexer implementation starts here
 
 Lexer::Lexer(const std::string& filename)
-    : filepath(filename), ifs(), type_table(), line(1)
+    : filepath(filename), mapping(nullptr), mapping_size(0),
+      buffer(), pos(nullptr), end(nullptr), pending(0), pool(), interned(),
+      input(-1), input_done(false), has_lookahead(false), lookahead(),
+      lookahead_text(), scanning(false), line(1)
 {
-    ifs.exceptions(std::ifstream::eofbit);
-    // TokenType::Declaration words
-    type_table.add(TokenType::Declaration,
-        "Declare", "Create", "Make", "Construct", "Spawn", "Manufacture",
-        "Name", "Label"
-    );
-    // TokenType::SetVar words
-    type_table.add(TokenType::SetVar,
-        "Change", "Set", "Vary", "Alter", "Modify", "Adjust"
-    );
-    // TokenType::ValueOf words
-    type_table.add(TokenType::ValueOf, "value");
-    // TokenType::Articles
-    type_table.add(TokenType::Article, "a", "an", "another", "the");
-    // TokenType::Or words
-    type_table.add(TokenType::Or, "or");
-    // TokenType::And words
-    type_table.add(TokenType::And, "and");
-    // TokenType::To words
-    type_table.add(TokenType::To, "to", "by", "into");
-    // TokenType::KnownAs words
-    type_table.add(TokenType::KnownAs, "named",  "called", "labeled", "titled");
-    // TokenType::End words
-    type_table.add(TokenType::End, "Stop", "End", "Quit", "Exit");
-    // TokenType::Plus words(not symbols)
-    type_table.add(TokenType::Plus, "plus");
-    // TokenType::Minus words(not symbols)
-    type_table.add(TokenType::Minus, "minus");
-    // TokenType::Times words(not symbols)
-    type_table.add(TokenType::Times, "times");
-    // TokenType::If words
-    type_table.add(TokenType::If, "If");
-    // TokenType::Else words
-    type_table.add(TokenType::Else, "Otherwise", "Else");
-    // TokenType::Equals words
-    type_table.add(TokenType::Equals, "equals");
-    // TokenType::Not words
-    type_table.add(TokenType::NotEquals, "differs");
-    // TokenType::BlockEnd words
-    type_table.add(TokenType::BlockEnd, "That's");
-    // TokenType::BlockBegin(W) words
-    type_table.add(TokenType::BlockBegin, "then:", "do:");
-    // TokenType::Is words(used as operator)
-    type_table.add(TokenType::Is, "is");
-    // TokenType::FuncName words
-    type_table.add(TokenType::FuncName, "Call", "Execute", "Evaluate");
-    // TokenType::FuncResult words
-    type_table.add(TokenType::FuncResult, "result", "outcome");
-    // TokenType::On words
-    type_table.add(TokenType::On, "on", "with");
-    // TokenType::Of words
-    type_table.add(TokenType::Of, "of", "from");
-    // TokenType::While words
-    type_table.add(TokenType::While, "While");
-    // TokenType::Comment words
-    type_table.add(TokenType::Comment, "Note", "Notice", "Note:", "Notice:");
-    // TokenType::Argument words
-    type_table.add(TokenType::Argument,
-        "argument", "arguments", "parameter", "parameters"
-    );
-    // TokenType::When words
-    type_table.add(TokenType::When, "When", "Whenever", "Upon");
-    // TokenType::Calling words
-    type_table.add(TokenType::Calling,
-        "calling", "executing", "evaluating", "running"
-    );
+
+}
+
+Lexer::~Lexer()
+{
+    close();
 }
 
 void Lexer::open()
 {
-    ifs.open(filepath.c_str());
+    close();
+    if(filepath == "-") {
+        std::ostringstream ss;
+        ss << std::cin.rdbuf();
+        buffer = ss.str();
+        pos = buffer.data();
+        end = pos + buffer.size();
+        return;
+    }
+    const int fd = ::open(filepath.c_str(), O_RDONLY);
+    if(fd < 0)
+        error("could not open file \"" + filepath + "\".");
+    struct stat st;
+    if(::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p != MAP_FAILED) {
+            ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+            mapping = p;
+            mapping_size = st.st_size;
+        }
+    }
+    ::close(fd);
+    if(mapping) {
+        pos = static_cast<const char*>(mapping);
+        end = pos + mapping_size;
+        return;
+    }
+    // Not mappable (empty, a pipe, ...), read it at once instead
+    std::ifstream ifs(filepath.c_str(), std::ios::binary);
     if(!ifs)
         error("could not open file \"" + filepath + "\".");
+    std::ostringstream ss;
+    ss << ifs.rdbuf();
+    buffer = ss.str();
+    pos = buffer.data();
+    end = pos + buffer.size();
+}
 
+void Lexer::openStream()
+{
+    close();
+    if(filepath == "-") {
+        input = STDIN_FILENO;
+    } else {
+        input = ::open(filepath.c_str(), O_RDONLY);
+        if(input < 0)
+            error("could not open file \"" + filepath + "\".");
+    }
+    input_done = false;
+    pos = end = buffer.data();
+}
+
+void Lexer::close()
+{
+    if(input > STDIN_FILENO)
+        ::close(input);
+    input = -1;
+    if(mapping)
+        ::munmap(mapping, mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+    buffer.clear();
+    pos = end = nullptr;
+    pending = 0;
+    interned.clear();
 }
 
+TextRef Lexer::intern(boost::string_view s)
+{
+    if(scanning)
+        return TextRef();
+    auto it = interned.find(s);
+    if(it != interned.end())
+        return it->second;
+    const TextRef ref = pool->add(s);
+    interned.emplace(s, ref);
+    return ref;
+}
+
+// Like std::isspace in the "C" locale, without the call
+static inline bool isSpace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
 
 // Needed for line counting
-char Lexer::readChar(bool ws = false)
+void Lexer::skipWhitespace()
 {
-    char ch = ifs.get();
-    if(ws) {
-        if(ch == '\n') ++line;
-        return ch;
+    if(pending)
+        return;
+    while(pos != end && isSpace(*pos)) {
+        if(*pos == '\n') ++line;
+        ++pos;
     }
-    while(isspace(ch)) {
-        if(ch == '\n') ++line;
-        ch = ifs.get();
-    }
-    return ch;
 }
 
 // We need this for handling dots in ALL strings
-void Lexer::readString(std::string& str)
+void Lexer::readString(boost::string_view& str)
 {
-    str = "";
-    char c = readChar(true);
-    while(!isspace(c)) {
-        str += c;
-        c = readChar(true);
+    // A word right after a dot or comma is no keyword
+    if(pending) {
+        str = boost::string_view();
+        return;
+    }
+    const char* begin = pos;
+    while(pos != end && !isSpace(*pos))
+        ++pos;
+    str = boost::string_view(begin, pos - begin);
+    // The whitespace ending the word is consumed (and counted)
+    if(pos != end) {
+        if(*pos == '\n') ++line;
+        ++pos;
     }
     // Check for dots and semicolons
-    if(str.back() == '.' || str.back() == ',') {
-        ifs.putback(str.back());
-        str.erase(str.end() - 1);
+    if(!str.empty() && (str.back() == '.' || str.back() == ',')) {
+        pending = str.back();
+        str.remove_suffix(1);
     }
 }
 
@@ -144,44 +186,36 @@ void Lexer::readString(std::string& str)
 // (unlike the STL does)
 double Lexer::readNumber()
 {
-    char c = readChar(true);
-    std::string result;
-    while(true) {
-        switch(c) {
-            case '0': case '1': case '2': case '3': case '4': case '5':
-            case '6': case '7': case '8': case '9': case '.':
-                result += c;
-                break;
-            default: {
-                // Since STL will ignore the dot, no need to remove it
-                // (just add it to the stream again)
-                if(result[result.length() - 1] == '.')
-                    ifs.putback('.');
-                std::stringstream ss;
-                ss << result;
-                double result;
-                ss>>result;
-                return result;
-            }
-        }
-        c = ifs.get();
-    }
-    return .0;
+    const char* begin = pos;
+    while(pos != end && ((*pos >= '0' && *pos <= '9') || *pos == '.'))
+        ++pos;
+    // A trailing dot ends the sentence
+    if(pos[-1] == '.')
+        --pos;
+    if(scanning)
+        return 0;
+    // Parse like a stream would (up to a second dot, if any)
+    return std::strtod(std::string(begin, pos).c_str(), nullptr);
 }
 
 void Lexer::skipSentence()
 {
-    while(readChar(true) != '.');
+    while(pos != end && *pos != '.') {
+        if(*pos == '\n') ++line;
+        ++pos;
+    }
+    if(pos != end)
+        ++pos;
 }
 
-Token Lexer::makeComparison(std::string& text)
+Token Lexer::makeComparison(boost::string_view& text)
 {
     Token t(TokenType::Operator);
     readString(text);
     if(text == "larger" || text == "greater")
-        t.setValue('>');
+        t.op = '>';
     else if(text == "smaller" || text == "less" || text == "lower")
-        t.setValue('<');
+        t.op = '<';
     else
         return Token(TokenType::Error);
     readString(text);
@@ -190,11 +224,11 @@ Token Lexer::makeComparison(std::string& text)
     return t;
 }
 
-Token Lexer::makeFunctionCall(std::string& text)
+Token Lexer::makeFunctionCall(boost::string_view& text)
 {
     readString(text);
     // Read an optional article before function
-    if(type_table[text] == TokenType::Article)
+    if(lookupKeyword(text) == TokenType::Article)
         readString(text);
     if(text != "function" && text != "subroutine" && text != "routine"
        && text != "procedure")
@@ -203,15 +237,15 @@ Token Lexer::makeFunctionCall(std::string& text)
     const Token str = get();
     if(str.type != TokenType::String)
         return Token(TokenType::Error);
-    return Token(str.getValue<std::string>(), TokenType::FuncName);
+    return Token(str.text, TokenType::FuncName);
 }
 
 Token Lexer::getTxt()
 {
-    std::string text;
+    boost::string_view text;
     readString(text);
-    // text[0] = std::tolower(text[0]);
-    switch(type_table[text]) {
+    const TokenType type = lookupKeyword(text);
+    switch(type) {
         case TokenType::Declaration: case TokenType::SetVar:
         case TokenType::End:         case TokenType::Article:
         case TokenType::To:          case TokenType::If:
@@ -220,7 +254,7 @@ Token Lexer::getTxt()
         case TokenType::Of:          case TokenType::Argument:
         case TokenType::KnownAs:     case TokenType::When:
         case TokenType::Calling:     case TokenType::Else:
-            return Token(type_table[text]);
+            return Token(type);
         case TokenType::FuncName:
             return makeFunctionCall(text);
         case TokenType::ValueOf:
@@ -256,57 +290,261 @@ Token Lexer::getTxt()
             return Token(TokenType::BlockEnd);
         case TokenType::Comment:
             skipSentence();
-            return get();
+            return Token(TokenType::Comment);
         default:
-            return Token(text, TokenType::Identifier);
+            return Token(intern(text), TokenType::Identifier);
     }
 
 }
 
 Token Lexer::get()
 {
-    char ch = readChar();
+    skipWhitespace();
+    if(pending) {
+        const char ch = pending;
+        pending = 0;
+        if(ch == '.')
+            return Token(TokenType::Dot);
+        return Token('&', TokenType::Operator);
+    }
+    if(pos == end)
+        return Token(TokenType::Error);
+    const char ch = *pos;
     switch(ch) {
         case '"': {
-            std::string value;
-            ch = ifs.get();
-            while(ch != '"') {
-                value += ch;
-                ch = ifs.get();
-            }
-            return Token(value, TokenType::String);
+            const char* begin = ++pos;
+            while(pos != end && *pos != '"')
+                ++pos;
+            if(pos == end)
+                return Token(TokenType::Error);
+            return Token(intern(boost::string_view(begin, pos++ - begin)), TokenType::String);
         }
         case '0': case '1': case '2': case '3': case '4':
         case '5': case '6': case '7': case '8': case '9':
-            ifs.putback(ch);
             return Token(readNumber(), TokenType::Number);
         case '+': case '-': case '*': case '/': case '(': case ')':
+            ++pos;
             return Token(ch, TokenType::Operator);
         case '.':
+            ++pos;
             return Token(TokenType::Dot);
         case ',':
+            ++pos;
             return Token('&', TokenType::Operator);
         default:
-            ifs.putback(ch);
             return getTxt();
     }
 
 }
 
-std::vector<Token> Lexer::tokenize()
+bool Lexer::refill(const char* keep)
+{
+    if(input < 0 || input_done)
+        return false;
+    const std::size_t offset = pos - keep;
+    buffer.erase(0, keep - buffer.data());
+    const std::size_t size = buffer.size();
+    buffer.resize(size + chunk_size);
+    ssize_t n;
+    do {
+        n = ::read(input, &buffer[size], chunk_size);
+    } while(n < 0 && errno == EINTR);
+    if(n < 0)
+        error("could not read file \"" + filepath + "\".");
+    buffer.resize(size + n);
+    input_done = n == 0;
+    // The keys referred to the old buffer
+    interned.clear();
+    pos = buffer.data() + offset;
+    end = buffer.data() + buffer.size();
+    return n > 0;
+}
+
+bool Lexer::next(Token& t)
+{
+    while(true) {
+        skipWhitespace();
+        if(pos == end && !pending) {
+            if(refill(pos))
+                continue;
+            return false;
+        }
+        const char* start = pos;
+        const int start_line = line;
+        const char start_pending = pending;
+        t = get();
+        if(pos != end || start_pending || input_done)
+            return true;
+        // A token running into the end of the buffer may go on in the
+        // input, it is read again once there is more of that
+        pos = start;
+        line = start_line;
+        pending = start_pending;
+        refill(start);
+    }
+}
+
+bool Lexer::take(Token& t)
+{
+    if(has_lookahead) {
+        t = lookahead;
+        if(t.hasText())
+            t.text = pool->add(lookahead_text);
+        has_lookahead = false;
+        return true;
+    }
+    do {
+        if(!next(t))
+            return false;
+    } while(t.type == TokenType::Comment);
+    t.line = line;
+    return true;
+}
+
+TokenStream Lexer::nextSentence()
+{
+    if(input < 0 && !input_done)
+        openStream();
+    pool = std::make_shared<StringPool>();
+    interned.clear();
+    TokenStream tokens(pool);
+    int nesting = 0;
+    // The dot ending an If statement's block may be followed by "Otherwise"
+    bool maybe_else = false;
+    bool had_else = false;
+    Token previous(TokenType::Unkown);
+    Token t;
+    while(take(t)) {
+        if(maybe_else && t.type != TokenType::Else) {
+            // It belongs to the next sentence
+            lookahead = t;
+            if(t.hasText()) {
+                const boost::string_view text = pool->get(t.text);
+                lookahead_text.assign(text.data(), text.size());
+            }
+            has_lookahead = true;
+            break;
+        }
+        maybe_else = false;
+        tokens.push_back(t);
+        if(t.type == TokenType::BlockBegin) {
+            ++nesting;
+        } else if(t.type == TokenType::BlockEnd) {
+            --nesting;
+        } else if(t.type == TokenType::Else) {
+            had_else = true;
+        } else if(t.type == TokenType::Dot && nesting <= 0) {
+            if(tokens.begin()->type != TokenType::If || had_else
+               || previous.type != TokenType::BlockEnd)
+                break;
+            maybe_else = true;
+        }
+        previous = t;
+    }
+    return tokens;
+}
+
+TokenStream Lexer::lex()
+{
+    pool = std::make_shared<StringPool>();
+    TokenStream tokens(pool);
+    while(true) {
+        skipWhitespace();
+        if(pos == end && !pending)
+            break;
+        Token t = get();
+        // Comments are dropped
+        if(t.type == TokenType::Comment)
+            continue;
+        t.line = line;
+        tokens.push_back(t);
+    }
+    return tokens;
+}
+
+TokenStream Lexer::tokenize()
 {
     open();
-    std::vector<Token> tokens;
-    try {
+    TokenStream tokens = lex();
+    // The tokens do not refer to the source
+    close();
+    return tokens;
+}
+
+TokenStream Lexer::tokenize(const Part& part)
+{
+    // The source may be this lexer's own, it is kept
+    pos = part.begin;
+    end = part.end;
+    pending = 0;
+    line = part.line;
+    interned.clear();
+    TokenStream tokens = lex();
+    interned.clear();
+    return tokens;
+}
+
+void Lexer::split(std::size_t count, std::size_t min_size,
+                  const std::function<void(const Part&)>& found)
+{
+    open();
+    Part part = { pos, end, line };
+    count = std::max<std::size_t>(count, 1);
+    const std::ptrdiff_t size = std::max<std::ptrdiff_t>((end - pos) / count, min_size);
+    if(size > 0 && end - pos >= 2 * size) {
+        // The sentences are followed like Lexer::nextSentence does
+        scanning = true;
+        int nesting = 0;
+        bool starting = true;
+        bool maybe_else = false;
+        bool had_else = false;
+        TokenType first = TokenType::Unkown;
+        TokenType previous = TokenType::Unkown;
+        // Where the last sentence ended, and the line there
+        const char* after = nullptr;
+        int after_line = 0;
         while(true) {
-            Token t = get();
-            t.line = line;
-            tokens.push_back(t);
+            skipWhitespace();
+            if(pos == end && !pending)
+                break;
+            const Token t = get();
+            if(t.type == TokenType::Comment)
+                continue;
+            if(maybe_else && t.type != TokenType::Else)
+                starting = true;
+            maybe_else = false;
+            if(starting) {
+                if(after && after - part.begin >= size) {
+                    part.end = after;
+                    found(part);
+                    part.begin = after;
+                    part.line = after_line;
+                }
+                starting = false;
+                first = t.type;
+                had_else = false;
+            }
+            if(t.type == TokenType::BlockBegin) {
+                ++nesting;
+            } else if(t.type == TokenType::BlockEnd) {
+                --nesting;
+            } else if(t.type == TokenType::Else) {
+                had_else = true;
+            } else if(t.type == TokenType::Dot && nesting <= 0) {
+                after = pos;
+                after_line = line;
+                if(first != TokenType::If || had_else || previous != TokenType::BlockEnd)
+                    starting = true;
+                else
+                    maybe_else = true;
+            }
+            previous = t.type;
         }
-    } catch(std::ifstream::failure) {
-        // EOF breaks the loop
+        scanning = false;
+        pending = 0;
     }
-    return tokens;
+    part.end = end;
+    found(part);
 }
 
 #endif
@@ -1,17 +1,53 @@
 #ifndef _TOKENSTREAMH_GUARD
 #define _TOKENSTREAMH_GUARD
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <stdexcept>
 #include <string>
-#include <fstream>
-#include <map>
+#include <unordered_map>
 #include <vector>
-#include <boost/any.hpp>
+#include <boost/utility/string_view.hpp>
+#include <boost/functional/hash.hpp>
 
 /**
- * Display an error message and throw an exception.
+ * The exception thrown by ::error, for a program that cannot be read.
+ */
+class ParseError : public std::runtime_error {
+    int line;
+public:
+    ParseError(const std::string& msg, int line)
+        : std::runtime_error(msg), line(line) {}
+
+    /**
+     * @return the line of the error, 0 if it is not known
+     */
+    int getLine() const
+    {
+        return line;
+    }
+};
+
+/**
+ * Display an error message and throw a ::ParseError.
  */
 void error(const std::string& msg, int line);
 
-enum class TokenType {
+/**
+ * Sends the messages of ::error on the calling thread to \a log instead of
+ * the standard error, or to the standard error again if \a log is nullptr.
+ * @return the log used before
+ */
+std::ostream* setErrorLog(std::ostream* log);
+
+/**
+ * @return where the messages of ::error on the calling thread go (see
+ *  ::setErrorLog)
+ */
+std::ostream& errorLog();
+
+enum class TokenType : std::uint8_t {
     Unkown,
     Begin, Declaration,
     SetVar, ValueOf,
@@ -31,66 +67,182 @@ enum class TokenType {
     Calling
 };
 
+/**
+ * The position of a string in a ::StringPool.
+ */
+struct TextRef {
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+/**
+ * A token of the source (a POD of 16 bytes). Identifiers, strings and
+ * function names carry a ::TextRef into the ::StringPool of their
+ * ::TokenStream, operators carry a char and numbers a double.
+ */
 class Token {
-    boost::any value;
 public:
     TokenType type;
     int line;
+    union {
+        double number;
+        char op;
+        TextRef text;
+    };
 
-    Token()
-        : value(), type(TokenType::Unkown), line(0) { }
+    Token() = default;
 
     Token(TokenType type)
-        : value(), type(type), line(0) { }
+        : type(type), line(0), number() { }
 
-    template<class T>
-    Token(const T& v, TokenType type)
-        : value(v), type(type), line(0) { }
+    Token(TextRef t, TokenType type)
+        : type(type), line(0), text(t) { }
 
-    template<class T>
-    void setValue(const T& v)
+    Token(double n, TokenType type)
+        : type(type), line(0), number(n) { }
+
+    Token(char o, TokenType type)
+        : type(type), line(0), op(o) { }
+
+    bool hasText() const
     {
-        value = v;
+        return type == TokenType::Identifier || type == TokenType::String
+            || type == TokenType::FuncName;
     }
 
+    /**
+     * Gets the value as double (numbers) or char (operators), the text is
+     * found with TokenStream::getText.
+     * @throw ParseError if the token has no value of that type
+     */
     template<class T>
-    T getValue() const
+    T getValue() const;
+};
+
+template<>
+inline double Token::getValue<double>() const
+{
+    if(type != TokenType::Number)
+        error("expecting a number", line);
+    return number;
+}
+
+template<>
+inline char Token::getValue<char>() const
+{
+    if(type != TokenType::Operator)
+        error("expecting an operator", line);
+    return op;
+}
+
+/**
+ * Holds the text of all tokens of a program, each distinct string once.
+ */
+class StringPool {
+    std::string chars;
+public:
+    TextRef add(boost::string_view s)
     {
-        return boost::any_cast<T>(value);
+        TextRef ref = { static_cast<std::uint32_t>(chars.size()),
+                        static_cast<std::uint32_t>(s.size()) };
+        chars.append(s.data(), s.size());
+        return ref;
+    }
+
+    boost::string_view get(TextRef ref) const
+    {
+        return boost::string_view(chars.data() + ref.offset, ref.length);
     }
 };
 
 /**
- * Maps words (as std::string) to ::TokenType objects.
+ * Classifies a word of the source.
+ * @return the type of the keyword, TokenType::Unkown if it is none
+ * @see Keywords.cpp (generated by tools/gen_keywords.py)
  */
-class TokenTable {
-    std::map<std::string, TokenType> table;
+TokenType lookupKeyword(boost::string_view word);
+
+/**
+ * The tokens of a program and the ::StringPool holding their text. Only the
+ * ::Lexer appends to it, the ::Parser reads it without changing it.
+ */
+class TokenStream {
+    std::vector<Token> tokens;
+    std::shared_ptr<const StringPool> pool;
 public:
-    TokenTable() = default;
+    typedef std::vector<Token>::const_iterator const_iterator;
+
+    TokenStream(std::shared_ptr<const StringPool> p)
+        : tokens(), pool(std::move(p)) {}
 
-    void add(TokenType t, const std::string& word);
+    const_iterator begin() const { return tokens.begin(); }
+    const_iterator end() const { return tokens.end(); }
+    std::size_t size() const { return tokens.size(); }
 
-    template<class... Rest>
-    void add(TokenType t, const std::string& word, const Rest&... words)
+    void push_back(const Token& t)
     {
-        add(t, word);
-        add(t, words...);
+        tokens.push_back(t);
     }
 
-    TokenType operator[](const std::string& word);
-};
+    /**
+     * @throw ParseError if the token has no text
+     */
+    boost::string_view getText(const Token& t) const
+    {
+        if(!t.hasText())
+            error("expecting a name or a string", t.line);
+        return pool->get(t.text);
+    }
 
-typedef std::vector<Token> TokenStream;
+    std::string getString(const Token& t) const
+    {
+        const boost::string_view text = getText(t);
+        return std::string(text.data(), text.size());
+    }
+};
 
+/**
+ * Splits a source file into tokens. The file is mapped into memory (or read
+ * into a buffer at once if it cannot be mapped) and scanned in place, the
+ * text of the tokens is interned into a ::StringPool.
+ *
+ * Lexer::nextSentence reads the source piece by piece instead, for running
+ * a program while it is read (see ::Streamer). The file name "-" stands for
+ * the standard input.
+ */
 class Lexer {
     std::string filepath;
-    std::ifstream ifs;
-    TokenTable type_table;
-    TokenStream tokens;
+    // The mapped file, or nullptr if it was read into buffer
+    void* mapping;
+    std::size_t mapping_size;
+    std::string buffer;
+    const char* pos;
+    const char* end;
+    // A character that was put back in front of pos (0 if none)
+    char pending;
+    std::shared_ptr<StringPool> pool;
+    // The strings in the pool (referring to the source while lexing)
+    std::unordered_map<boost::string_view, TextRef,
+                       boost::hash<boost::string_view> > interned;
+    // The file read by Lexer::nextSentence (-1 if it is not open yet), and
+    // whether all of it is in buffer
+    int input;
+    bool input_done;
+    // A token read past the end of the last sentence, with its text
+    bool has_lookahead;
+    Token lookahead;
+    std::string lookahead_text;
+    // Whether tokens are only looked at by Lexer::split, which needs no
+    // text or value of them
+    bool scanning;
+
+    static const std::size_t chunk_size = 64 * 1024;
+
+    TextRef intern(boost::string_view s);
 
-    char readChar(bool ws);
+    void skipWhitespace();
 
-    void readString(std::string& str);
+    void readString(boost::string_view& str);
 
     double readNumber();
 
@@ -99,12 +251,12 @@ class Lexer {
     /**
      * Makes a comparions operator ::Token.
      */
-    Token makeComparison(std::string& text);
+    Token makeComparison(boost::string_view& text);
 
     /**
      * Makes a function call ::Token.
      */
-    Token makeFunctionCall(std::string& text);
+    Token makeFunctionCall(boost::string_view& text);
 
     /**
      * Extracts a ::Token beginning with a word from the ::Lexer
@@ -113,12 +265,80 @@ class Lexer {
 
     Token get();
 
+    /**
+     * Reads more of the input into buffer, dropping what comes before
+     * \a keep.
+     * @return false at the end of the input
+     */
+    bool refill(const char* keep);
+
+    /**
+     * Gets the next token of the input, reading more of it as needed.
+     * @return false at the end of the input
+     */
+    bool next(Token& t);
+
+    /**
+     * Gets the next token for Lexer::nextSentence, comments are dropped.
+     * @return false at the end of the input
+     */
+    bool take(Token& t);
+
     void open();
+    void openStream();
+    void close();
+
+    /**
+     * Lexes from pos to end, comments are dropped.
+     */
+    TokenStream lex();
 public:
     int line;
 
+    /**
+     * A piece of the source beginning with a top-level sentence, and the
+     * line it begins on.
+     */
+    struct Part {
+        const char* begin;
+        const char* end;
+        int line;
+    };
+
     Lexer(const std::string& filename);
+    ~Lexer();
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
 
     TokenStream tokenize();
+
+    /**
+     * Opens the source and splits it into about \a count parts of the same
+     * size (but no smaller than \a min_size bytes), for lexing and parsing
+     * them apart (see ::ParallelParser). A part ends with the dot of a
+     * top-level sentence that is not followed by "Otherwise", so no
+     * statement spans two of them.
+     *
+     * \a found is called with each part (in order) as soon as its end is
+     * known, the parts refer to the source, which is kept until the
+     * ::Lexer is gone.
+     */
+    void split(std::size_t count, std::size_t min_size,
+               const std::function<void(const Part&)>& found);
+
+    /**
+     * Lexes a \a part of a source in memory, like one split by this or
+     * another ::Lexer (which has to outlive this call), the way
+     * Lexer::tokenize lexes the whole of it.
+     */
+    TokenStream tokenize(const Part& part);
+
+    /**
+     * Reads the tokens of the next top-level sentence (a statement with the
+     * blocks it contains), only as much of the input as needed is read.
+     * Each sentence has a ::StringPool of its own.
+     * @return an empty ::TokenStream at the end of the input
+     */
+    TokenStream nextSentence();
 };
 #endif
@@ -0,0 +1,318 @@
+#include "VM.h"
+#include <stdexcept>
+
+// GCC and clang support taking the address of a label, which allows a
+// threaded dispatch (one indirect jump per instruction instead of a switch).
+#if defined(__GNUC__)
+#define NOTENGLISH_COMPUTED_GOTO
+#endif
+
+namespace Bytecode {
+
+    void VM::Storage::clear()
+    {
+        args.clear();
+        sites.clear();
+        frames.clear();
+        registers.clear();
+    }
+
+    VM::VM(DataHandler& d, const Program& p)
+        : VM(d, p, own)
+    {
+
+    }
+
+    VM::VM(DataHandler& d, const Program& p, Storage& storage)
+        : data(d), program(p), own(), args(storage.args), sites(storage.sites),
+          frames(storage.frames), registers(storage.registers)
+    {
+        frames.reserve(256);
+        registers.reserve(4096);
+    }
+
+    void VM::execute()
+    {
+        const Chunk& main = program.chunks.front();
+        args.clear();
+        sites.assign(program.names.size(), CallSite());
+        frames.assign(1, Frame{&main, nullptr, 0});
+        reserve(0, main);
+        run();
+    }
+
+    CallSite& VM::lookup(std::uint32_t name)
+    {
+        CallSite& site = sites[name];
+        if(!data.lookup(program.names[name], site))
+            throw std::runtime_error("use of nonexistant function " + program.names[name]);
+        return site;
+    }
+
+    Value VM::callSys(SysFunc func, std::size_t argc)
+    {
+        arg_t vargs(args.end() - argc, args.end());
+        args.resize(args.size() - argc);
+        return func(data, vargs);
+    }
+
+    const Chunk& VM::enter(std::uint32_t name, Function& func, std::size_t argc)
+    {
+        if(!func.getCode())
+            throw std::runtime_error("Undefined function " + program.names[name] + " used.");
+        const Chunk& body = *func.getCode();
+        data.addScope(program.scopes[body.scope], func.getHome());
+        // The arguments occupy the first slots of the function's scope
+        const std::size_t first = args.size() - argc;
+        for(std::size_t i = 0; i < func.getArgs().size() && i < argc; ++i)
+            data.getVar(0, i) = args[first + i];
+        args.resize(first);
+        return body;
+    }
+
+    void VM::call(const Instruction* ip, Function& func)
+    {
+        const Chunk& body = enter(ip->c, func, ip->b);
+        Frame& caller = frames.back();
+        caller.ip = ip;
+        const std::size_t base = caller.base + caller.chunk->registers;
+        frames.push_back(Frame{&body, nullptr, base});
+        reserve(base, body);
+    }
+
+    Value* VM::reserve(std::size_t base, const Chunk& chunk)
+    {
+        if(registers.size() < base + chunk.registers)
+            registers.resize(base + chunk.registers);
+        return registers.data() + base;
+    }
+
+    void VM::undefined(const Chunk& chunk, const Instruction* ip)
+    {
+        const std::string& name = program.names[chunk.symbols.at(ip - chunk.code.data())];
+        throw std::runtime_error("Undefined variable " + name + " used.");
+    }
+
+    void VM::doubleDeclared(const Chunk& chunk, const Instruction* ip)
+    {
+        const std::string& name = program.names[chunk.symbols.at(ip - chunk.code.data())];
+        throw std::runtime_error("Variable " + name + " double declared.");
+    }
+
+    void VM::run()
+    {
+        const Chunk* chunk = frames.back().chunk;
+        Value* r = registers.data() + frames.back().base;
+        const Instruction* ip = chunk->code.data();
+
+#ifdef NOTENGLISH_COMPUTED_GOTO
+        static void* const dispatch_table[] = {
+#define NOTENGLISH_OPCODE_LABEL(name) &&op_##name,
+            NOTENGLISH_OPCODES(NOTENGLISH_OPCODE_LABEL)
+#undef NOTENGLISH_OPCODE_LABEL
+        };
+#define VM_CASE(name) op_##name:
+#define VM_NEXT() goto *dispatch_table[static_cast<std::uint8_t>((++ip)->op)]
+#define VM_JUMP(target) do { ip = chunk->code.data() + (target); \
+    goto *dispatch_table[static_cast<std::uint8_t>(ip->op)]; } while(0)
+// Starts running the top frame (after a call)
+#define VM_ENTER() do { chunk = frames.back().chunk; \
+    r = registers.data() + frames.back().base; VM_JUMP(0); } while(0)
+        goto *dispatch_table[static_cast<std::uint8_t>(ip->op)];
+#else
+#define VM_CASE(name) case OpCode::name:
+#define VM_NEXT() ++ip; continue
+#define VM_JUMP(target) { ip = chunk->code.data() + (target); continue; }
+#define VM_ENTER() { chunk = frames.back().chunk; \
+    r = registers.data() + frames.back().base; VM_JUMP(0) }
+        while(true) {
+        switch(ip->op) {
+#endif
+        VM_CASE(LoadConst)
+            r[ip->a] = program.constants[ip->c];
+            VM_NEXT();
+        VM_CASE(LoadVar) {
+            const VarPtr& var = data.getVar(ip->b, ip->c);
+            if(!var)
+                undefined(*chunk, ip);
+            r[ip->a] = *var;
+            VM_NEXT();
+        }
+        VM_CASE(StoreVar) {
+            const VarPtr& var = data.getVar(ip->b, ip->c);
+            if(!var)
+                undefined(*chunk, ip);
+            *var = r[ip->a];
+            VM_NEXT();
+        }
+        // The operators check for numbers in line, anything else (and
+        // any error) is left to ::Value
+        VM_CASE(Add)
+            if(r[ip->b].isNumber() && r[ip->c].isNumber())
+                r[ip->a].setNumber(r[ip->b].number() + r[ip->c].number());
+            else
+                r[ip->a] = Value::add(r[ip->b], r[ip->c]);
+            VM_NEXT();
+        VM_CASE(Sub)
+            if(r[ip->b].isNumber() && r[ip->c].isNumber())
+                r[ip->a].setNumber(r[ip->b].number() - r[ip->c].number());
+            else
+                r[ip->a] = Value::subtract(r[ip->b], r[ip->c]);
+            VM_NEXT();
+        VM_CASE(Mul)
+            if(r[ip->b].isNumber() && r[ip->c].isNumber())
+                r[ip->a].setNumber(r[ip->b].number() * r[ip->c].number());
+            else
+                r[ip->a] = Value::multiply(r[ip->b], r[ip->c]);
+            VM_NEXT();
+        VM_CASE(Div)
+            if(r[ip->b].isNumber() && r[ip->c].isNumber())
+                r[ip->a].setNumber(r[ip->b].number() / r[ip->c].number());
+            else
+                r[ip->a] = Value::divide(r[ip->b], r[ip->c]);
+            VM_NEXT();
+        VM_CASE(Neg)
+            r[ip->a] = Value::negate(r[ip->b]);
+            VM_NEXT();
+        VM_CASE(And)
+            r[ip->a] = Value::logicalAnd(r[ip->b], r[ip->c]);
+            VM_NEXT();
+        VM_CASE(Or)
+            r[ip->a] = Value::logicalOr(r[ip->b], r[ip->c]);
+            VM_NEXT();
+        VM_CASE(Equals)
+            if(r[ip->b].isNumber() && r[ip->c].isNumber())
+                r[ip->a].setBoolean(r[ip->b].number() == r[ip->c].number());
+            else
+                r[ip->a] = Value::equals(r[ip->b], r[ip->c]);
+            VM_NEXT();
+        VM_CASE(NotEquals)
+            if(r[ip->b].isNumber() && r[ip->c].isNumber())
+                r[ip->a].setBoolean(r[ip->b].number() != r[ip->c].number());
+            else
+                r[ip->a] = Value::notEquals(r[ip->b], r[ip->c]);
+            VM_NEXT();
+        VM_CASE(Smaller)
+            if(r[ip->b].isNumber() && r[ip->c].isNumber())
+                r[ip->a].setBoolean(r[ip->b].number() < r[ip->c].number());
+            else
+                r[ip->a] = Value::smaller(r[ip->b], r[ip->c]);
+            VM_NEXT();
+        VM_CASE(Greater)
+            if(r[ip->b].isNumber() && r[ip->c].isNumber())
+                r[ip->a].setBoolean(r[ip->b].number() > r[ip->c].number());
+            else
+                r[ip->a] = Value::greater(r[ip->b], r[ip->c]);
+            VM_NEXT();
+        VM_CASE(Jump)
+            VM_JUMP(ip->c);
+        VM_CASE(JumpIfFalse)
+            if(!r[ip->a].getValue<Value::BoolType>())
+                VM_JUMP(ip->c);
+            VM_NEXT();
+        VM_CASE(ArgVar) {
+            const VarPtr& var = data.getVar(ip->b, ip->c);
+            if(!var)
+                undefined(*chunk, ip);
+            args.push_back(var);
+            VM_NEXT();
+        }
+        VM_CASE(LoadName)
+            r[ip->a] = *data.getVar(program.names[ip->c]);
+            VM_NEXT();
+        VM_CASE(StoreName)
+            *data.getVar(program.names[ip->c]) = r[ip->a];
+            VM_NEXT();
+        VM_CASE(ArgName)
+            args.push_back(data.getVar(program.names[ip->c]));
+            VM_NEXT();
+        VM_CASE(ArgConst)
+            args.push_back(make_variable(program.constants[ip->c]));
+            VM_NEXT();
+        VM_CASE(ArgReg)
+            args.push_back(make_variable(r[ip->a]));
+            VM_NEXT();
+        VM_CASE(Call) {
+            CallSite& site = lookup(ip->c);
+            if(site.sys) {
+                r[ip->a] = callSys(site.sys, ip->b);
+                VM_NEXT();
+            }
+            call(ip, *site.func);
+            VM_ENTER();
+        }
+        VM_CASE(TailCall) {
+            CallSite& site = lookup(ip->c);
+            if(site.sys) {
+                callSys(site.sys, ip->b);
+                VM_NEXT();
+            }
+            // The scopes of the caller can only go if no function could be
+            // found in them
+            if(data.holdsFuncs(ip->a + 1)) {
+                call(ip, *site.func);
+                VM_ENTER();
+            }
+            for(int i = 0; i <= ip->a; ++i)
+                data.popScope();
+            Frame& frame = frames.back();
+            frame.chunk = &enter(ip->c, *site.func, ip->b);
+            reserve(frame.base, *frame.chunk);
+            VM_ENTER();
+        }
+        VM_CASE(EnterScope)
+            data.addScope(program.scopes[ip->c]);
+            VM_NEXT();
+        VM_CASE(LeaveScope)
+            data.popScope();
+            VM_NEXT();
+        VM_CASE(DeclareVar) {
+            VarPtr& var = data.getVar(0, ip->c);
+            if(var)
+                doubleDeclared(*chunk, ip);
+            var = make_variable(Value());
+            VM_NEXT();
+        }
+        VM_CASE(Shadowed)
+            if(data.getVar(ip->b, ip->c))
+                doubleDeclared(*chunk, ip);
+            VM_NEXT();
+        VM_CASE(DeclareFunc) {
+            const FunctionInfo& info = program.functions[ip->c];
+            if(data.funcExists(info.name))
+                throw std::runtime_error("Function " + info.name + " double declared.");
+            data.addFunc(info.name, info.args);
+            VM_NEXT();
+        }
+        VM_CASE(ImplementFunc) {
+            Function* func = data.findFunc(program.names[ip->c]);
+            if(!func || func->getHome() != data.getScope(ip->a))
+                throw std::runtime_error("Undefined function " + program.names[ip->c] + " used.");
+            func->setCode(&program.chunks[ip->b]);
+            VM_NEXT();
+        }
+        VM_CASE(Throw)
+            throw std::runtime_error(program.names[ip->c]);
+        VM_CASE(Return) {
+            frames.pop_back();
+            if(frames.empty())
+                return;
+            // Leave the function's scope and go on after the call
+            data.popScope();
+            chunk = frames.back().chunk;
+            r = registers.data() + frames.back().base;
+            ip = frames.back().ip;
+            if(ip->op == OpCode::Call)
+                r[ip->a] = Value();
+            VM_NEXT();
+        }
+#ifndef NOTENGLISH_COMPUTED_GOTO
+        }
+        }
+#endif
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_JUMP
+#undef VM_ENTER
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef _NOTENGLISH_VM_H_INCLUDE_GUARD
+#define _NOTENGLISH_VM_H_INCLUDE_GUARD
+
+#include "Bytecode.h"
+#include "DataHandler.h"
+
+namespace Bytecode {
+
+    /**
+     * Executes a Bytecode::Program. Registers hold plain ::Value objects,
+     * a ::VarPtr is only created where a function argument needs one.
+     *
+     * Calls of user-defined functions do not recurse on the host stack:
+     * each call pushes a Frame, whose registers are a window of one
+     * contiguous register file. A OpCode::TailCall replaces the frame of
+     * the caller instead.
+     */
+    class VM {
+        struct Frame {
+            const Chunk* chunk;
+            // The call being made by this frame, if it is not the top one
+            const Instruction* ip;
+            // The first register of the frame
+            std::size_t base;
+        };
+
+    public:
+        /**
+         * The memory of a ::VM: its frames, registers, pushed arguments and
+         * call sites. A ::Storage given to one ::VM after another (as an
+         * ::Interpreter does) is reused instead of allocated by each.
+         */
+        class Storage {
+            friend class VM;
+            arg_t args;
+            // The function each name of the program was last called as
+            std::vector<CallSite> sites;
+            std::vector<Frame> frames;
+            std::vector<Value> registers;
+        public:
+            /**
+             * Drops the values of the last run, the memory is kept.
+             */
+            void clear();
+        };
+
+    private:
+        DataHandler& data;
+        const Program& program;
+        // The storage of a VM not given one
+        Storage own;
+        arg_t& args;
+        std::vector<CallSite>& sites;
+        std::vector<Frame>& frames;
+        std::vector<Value>& registers;
+
+        void run();
+        [[noreturn]] void undefined(const Chunk& chunk, const Instruction* ip);
+        [[noreturn]] void doubleDeclared(const Chunk& chunk, const Instruction* ip);
+        /**
+         * Finds the function called names[\a name].
+         */
+        CallSite& lookup(std::uint32_t name);
+        /**
+         * Calls a system function with the last \a argc pushed arguments.
+         */
+        Value callSys(SysFunc func, std::size_t argc);
+        /**
+         * Makes the ::Scope of a call of a user-defined function and binds
+         * the last \a argc pushed arguments.
+         * @return the body of the function
+         */
+        const Chunk& enter(std::uint32_t name, Function& func, std::size_t argc);
+        /**
+         * Pushes the frame of a call of \a func made by the instruction at
+         * \a ip.
+         */
+        void call(const Instruction* ip, Function& func);
+        /**
+         * Makes sure the registers of a frame starting at \a base exist.
+         * @return the first register of the frame
+         */
+        Value* reserve(std::size_t base, const Chunk& chunk);
+    public:
+        VM(DataHandler& d, const Program& p);
+        /**
+         * A ::VM running in \a storage.
+         */
+        VM(DataHandler& d, const Program& p, Storage& storage);
+        void execute();
+    };
+}
+
+#endif // _NOTENGLISH_VM_H_INCLUDE_GUARD
@@ -0,0 +1,194 @@
+#include "Value.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
+
+static_assert(sizeof(Value) == 16, "Value is meant to fit in 16 bytes");
+
+char* Value::allocString(std::size_t size, std::size_t capacity)
+{
+    large.type = Type::String;
+    if(size <= small_capacity) {
+        small.size = size;
+        return small.data;
+    }
+    if(size > std::numeric_limits<std::uint32_t>::max())
+        throw std::length_error("string too long");
+    capacity = std::max(size, capacity);
+    small.size = large_string;
+    large.length = size;
+    void* mem = ::operator new(offsetof(StringRep, data) + capacity);
+    large.rep = static_cast<StringRep*>(mem);
+    new (&large.rep->refs) std::atomic<std::size_t>(1);
+    large.rep->capacity = capacity;
+    new (&large.rep->used) std::atomic<std::size_t>(size);
+    return large.rep->data;
+}
+
+void Value::setString(const char* s, std::size_t size)
+{
+    std::memcpy(allocString(size), s, size);
+}
+
+Value Value::concat(const Value& lhs, const Value& rhs)
+{
+    const std::size_t lsize = lhs.stringSize();
+    const std::size_t rsize = rhs.stringSize();
+    Value result;
+    if(!lhs.isSmall()) {
+        // Appends in place if lhs ends where its buffer does, claiming the
+        // room first (no other string may be using it)
+        StringRep* rep = lhs.large.rep;
+        std::size_t end = lsize;
+        if(rsize <= rep->capacity - lsize
+           && lsize + rsize <= std::numeric_limits<std::uint32_t>::max()
+           && rep->used.compare_exchange_strong(end, lsize + rsize, std::memory_order_relaxed)) {
+            // rhs may be a prefix of the same buffer, it ends before lsize
+            std::memcpy(rep->data + lsize, rhs.stringData(), rsize);
+            result.copy(lhs);
+            result.large.length = lsize + rsize;
+            return result;
+        }
+    }
+    // A long lhs is probably being appended to, room is left for more
+    const std::size_t capacity = lhs.isSmall() ? 0 : 2 * (lsize + rsize);
+    char* data = result.allocString(lsize + rsize, capacity);
+    std::memcpy(data, lhs.stringData(), lsize);
+    std::memcpy(data + lsize, rhs.stringData(), rsize);
+    return result;
+}
+
+int Value::compareStrings(const Value& lhs, const Value& rhs)
+{
+    const std::size_t lsize = lhs.stringSize();
+    const std::size_t rsize = rhs.stringSize();
+    // Strings sharing a buffer share their characters
+    if(lhs.stringData() == rhs.stringData())
+        return lsize < rsize ? -1 : (lsize > rsize ? 1 : 0);
+    int result = std::memcmp(lhs.stringData(), rhs.stringData(), std::min(lsize, rsize));
+    if(result != 0)
+        return result;
+    return lsize < rsize ? -1 : (lsize > rsize ? 1 : 0);
+}
+
+static Value invalidOperator()
+{
+    throw std::runtime_error("invalid usage of operator");
+}
+
+Value Value::add(const Value& lhs, const Value& rhs)
+{
+    if(lhs.getType() == rhs.getType()) {
+        if(lhs.isNumber())
+            return lhs.large.number + rhs.large.number;
+        if(lhs.getType() == Type::String)
+            return concat(lhs, rhs);
+    }
+    return invalidOperator();
+}
+
+Value Value::subtract(const Value& lhs, const Value& rhs)
+{
+    if(lhs.isNumber() && rhs.isNumber())
+        return lhs.large.number - rhs.large.number;
+    return invalidOperator();
+}
+
+Value Value::multiply(const Value& lhs, const Value& rhs)
+{
+    if(lhs.isNumber() && rhs.isNumber())
+        return lhs.large.number * rhs.large.number;
+    return invalidOperator();
+}
+
+Value Value::divide(const Value& lhs, const Value& rhs)
+{
+    if(lhs.isNumber() && rhs.isNumber())
+        return lhs.large.number / rhs.large.number;
+    return invalidOperator();
+}
+
+Value Value::negate(const Value& v)
+{
+    // Negating anything but a number has always resulted in zero
+    if(v.isNumber())
+        return -v.large.number;
+    return 0.0;
+}
+
+Value Value::logicalAnd(const Value& lhs, const Value& rhs)
+{
+    if(lhs.getType() == Type::Boolean && rhs.getType() == Type::Boolean)
+        return lhs.large.boolean && rhs.large.boolean;
+    return invalidOperator();
+}
+
+Value Value::logicalOr(const Value& lhs, const Value& rhs)
+{
+    if(lhs.getType() == Type::Boolean && rhs.getType() == Type::Boolean)
+        return lhs.large.boolean || rhs.large.boolean;
+    return invalidOperator();
+}
+
+Value Value::equals(const Value& lhs, const Value& rhs)
+{
+    if(lhs.getType() == rhs.getType()) {
+        if(lhs.isNumber())
+            return lhs.large.number == rhs.large.number;
+        if(lhs.getType() == Type::String)
+            return compareStrings(lhs, rhs) == 0;
+    }
+    return invalidOperator();
+}
+
+Value Value::notEquals(const Value& lhs, const Value& rhs)
+{
+    if(lhs.getType() == rhs.getType()) {
+        if(lhs.isNumber())
+            return lhs.large.number != rhs.large.number;
+        if(lhs.getType() == Type::String)
+            return compareStrings(lhs, rhs) != 0;
+    }
+    return invalidOperator();
+}
+
+Value Value::smaller(const Value& lhs, const Value& rhs)
+{
+    if(lhs.getType() == rhs.getType()) {
+        if(lhs.isNumber())
+            return lhs.large.number < rhs.large.number;
+        if(lhs.getType() == Type::String)
+            return compareStrings(lhs, rhs) < 0;
+    }
+    return invalidOperator();
+}
+
+Value Value::greater(const Value& lhs, const Value& rhs)
+{
+    if(lhs.getType() == rhs.getType()) {
+        if(lhs.isNumber())
+            return lhs.large.number > rhs.large.number;
+        if(lhs.getType() == Type::String)
+            return compareStrings(lhs, rhs) > 0;
+    }
+    return invalidOperator();
+}
+
+Value Value::apply(char op, const Value& lhs, const Value& rhs)
+{
+    switch(op) {
+        case '+': return add(lhs, rhs);
+        case '-': return subtract(lhs, rhs);
+        case '*': return multiply(lhs, rhs);
+        case '/': return divide(lhs, rhs);
+        case '&': return logicalAnd(lhs, rhs);
+        case '|': return logicalOr(lhs, rhs);
+        case '=': return equals(lhs, rhs);
+        case '!': return notEquals(lhs, rhs);
+        case '<': return smaller(lhs, rhs);
+        case '>': return greater(lhs, rhs);
+        default:
+            throw std::runtime_error(std::string("Invalid operator ") + op);
+    }
+}
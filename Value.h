@@ -0,0 +1,261 @@
+/**
+ * @file Value.h Provides ::Value, the representation of all values the
+ * language knows of. Values are passed by value while evaluating
+ * expressions: numbers and booleans never allocate, short strings are
+ * stored inline and longer strings are shared (refcounted).
+ *
+ * A longer string is a prefix of a buffer that can have room to spare,
+ * several strings can share one buffer with different lengths. The
+ * characters of a string never change: appending to the string that ends
+ * where the buffer does writes into the spare room, which only makes that
+ * one longer. So building a string by appending to it over and over takes
+ * amortized constant time per append.
+ */
+#ifndef _NOTENGLISH_VALUE_H_INCLUDE_GUARD
+#define _NOTENGLISH_VALUE_H_INCLUDE_GUARD
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+
+class Value {
+public:
+    enum class Type : std::uint8_t {
+        Number, String, Boolean, Unkown
+    };
+    typedef double NumberType;
+    typedef std::string StringType;
+    typedef bool BoolType;
+
+    Value()
+    {
+        large.type = Type::Unkown;
+    }
+
+    Value(NumberType n)
+    {
+        large.type = Type::Number;
+        large.number = n;
+    }
+
+    Value(BoolType b)
+    {
+        large.type = Type::Boolean;
+        large.boolean = b;
+    }
+
+    Value(const StringType& s)
+    {
+        setString(s.data(), s.size());
+    }
+
+    Value(const char* s, std::size_t size)
+    {
+        setString(s, size);
+    }
+
+    // Without this, string literals would become booleans
+    Value(const char* s)
+    {
+        setString(s, std::char_traits<char>::length(s));
+    }
+
+    Value(const Value& other)
+    {
+        copy(other);
+    }
+
+    Value(Value&& other)
+    {
+        small = other.small;
+        other.large.type = Type::Unkown;
+    }
+
+    ~Value()
+    {
+        release();
+    }
+
+    Value& operator=(const Value& other)
+    {
+        if(this != &other) {
+            release();
+            copy(other);
+        }
+        return *this;
+    }
+
+    Value& operator=(Value&& other)
+    {
+        if(this != &other) {
+            release();
+            small = other.small;
+            other.large.type = Type::Unkown;
+        }
+        return *this;
+    }
+
+    Type getType() const
+    {
+        return large.type;
+    }
+
+    bool isNumber() const
+    {
+        return large.type == Type::Number;
+    }
+
+    /**
+     * Gets the value as a given type (one of NumberType, StringType and
+     * BoolType).
+     * @throw std::runtime_error if the value has another type
+     */
+    template<class T>
+    T getValue() const;
+
+    /**
+     * Turns this into the number \a n, like assigning Value(n) would.
+     */
+    void setNumber(NumberType n)
+    {
+        release();
+        large.type = Type::Number;
+        large.number = n;
+    }
+
+    void setBoolean(BoolType b)
+    {
+        release();
+        large.type = Type::Boolean;
+        large.boolean = b;
+    }
+
+    /**
+     * Unchecked access to a number, only valid if isNumber().
+     */
+    NumberType number() const
+    {
+        return large.number;
+    }
+
+    /**
+     * @return the characters of a string value (not null-terminated)
+     */
+    const char* stringData() const
+    {
+        return isSmall() ? small.data : large.rep->data;
+    }
+
+    std::size_t stringSize() const
+    {
+        return isSmall() ? small.size : large.length;
+    }
+
+    // Operators, these fail on operands of the wrong type
+    static Value add(const Value& lhs, const Value& rhs);
+    static Value subtract(const Value& lhs, const Value& rhs);
+    static Value multiply(const Value& lhs, const Value& rhs);
+    static Value divide(const Value& lhs, const Value& rhs);
+    static Value negate(const Value& v);
+    static Value logicalAnd(const Value& lhs, const Value& rhs);
+    static Value logicalOr(const Value& lhs, const Value& rhs);
+    static Value equals(const Value& lhs, const Value& rhs);
+    static Value notEquals(const Value& lhs, const Value& rhs);
+    static Value smaller(const Value& lhs, const Value& rhs);
+    static Value greater(const Value& lhs, const Value& rhs);
+
+    /**
+     * Applies a binary operator as written by the Parser ('+', '&', '<', ...).
+     */
+    static Value apply(char op, const Value& lhs, const Value& rhs);
+private:
+    // The buffer of strings too long to be stored inline
+    struct StringRep {
+        std::atomic<std::size_t> refs;
+        std::size_t capacity;
+        // The characters in use by the longest string
+        std::atomic<std::size_t> used;
+        char data[1];
+    };
+
+    static const std::size_t small_capacity = 14;
+    // Marks a string stored in a StringRep
+    static const std::uint8_t large_string = 0xff;
+
+    // Both layouts start with the type (a common initial sequence), Small
+    // spans all 16 bytes so copying it copies any value
+    struct Small {
+        Type type;
+        std::uint8_t size;
+        char data[small_capacity];
+    };
+
+    struct Large {
+        Type type;
+        std::uint8_t size;
+        std::uint32_t length;
+        union {
+            NumberType number;
+            BoolType boolean;
+            StringRep* rep;
+        };
+    };
+
+    union {
+        Small small;
+        Large large;
+    };
+
+    bool isSmall() const
+    {
+        return small.size != large_string;
+    }
+
+    // Turns this into an uninitialised string of the given size, a buffer
+    // of the string gets room for at least capacity characters
+    char* allocString(std::size_t size, std::size_t capacity = 0);
+    void setString(const char* s, std::size_t size);
+    static Value concat(const Value& lhs, const Value& rhs);
+    static int compareStrings(const Value& lhs, const Value& rhs);
+
+    void copy(const Value& other)
+    {
+        small = other.small;
+        if(large.type == Type::String && !isSmall())
+            large.rep->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release()
+    {
+        if(large.type == Type::String && !isSmall()
+           && large.rep->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            ::operator delete(large.rep);
+    }
+};
+
+template<>
+inline Value::NumberType Value::getValue<Value::NumberType>() const
+{
+    if(large.type != Type::Number)
+        throw std::runtime_error("type violation of Variable");
+    return large.number;
+}
+
+template<>
+inline Value::BoolType Value::getValue<Value::BoolType>() const
+{
+    if(large.type != Type::Boolean)
+        throw std::runtime_error("type violation of Variable");
+    return large.boolean;
+}
+
+template<>
+inline Value::StringType Value::getValue<Value::StringType>() const
+{
+    if(large.type != Type::String)
+        throw std::runtime_error("type violation of Variable");
+    return StringType(stringData(), stringSize());
+}
+
+#endif // _NOTENGLISH_VALUE_H_INCLUDE_GUARD
@@ -0,0 +1,297 @@
+/**
+ * @file bench.cpp Micro-benchmarks of the interpreter. Each workload is a
+ * generated program stressing one hot path; it is written to a temporary
+ * .ext file and run through the whole pipeline, timing every phase
+ * separately. The results are printed as JSON:
+ *
+ *     ./bin/NotEnglish_bench [--repeat=N] [--scale=F] [--engine=vm|ast]
+ *                            [--no-jit] [--keep] [workload...]
+ *
+ * The time of a phase is the best of all repetitions.
+ */
+#include "TokenHandler.h"
+#include "Resolver.h"
+#include "Optimizer.h"
+#include "Compiler.h"
+#include "VM.h"
+#include "Jit.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Workload {
+        const char* name;
+        const char* description;
+        std::function<std::string(double)> generate;
+    };
+
+    struct Times {
+        double lex;
+        double parse;
+        double resolve;
+        double execute;
+        std::size_t tokens;
+    };
+
+    std::size_t scaled(double scale, std::size_t n)
+    {
+        return std::max<std::size_t>(1, static_cast<std::size_t>(n * scale));
+    }
+
+    std::string numericLoop(double scale)
+    {
+        std::ostringstream ss;
+        ss << "Create a variable i. Set i to 0.\n"
+           << "Create a variable x. Set x to 0.\n"
+           << "While i is lower than " << scaled(scale, 200000) << " do:\n"
+           << "Set x to x plus i times 2 minus x / 3.\n"
+           << "Set i to i plus 1.\n"
+           << "That's all.\n";
+        return ss.str();
+    }
+
+    std::string stringConcat(double scale)
+    {
+        std::ostringstream ss;
+        ss << "Create a variable s. Set s to \"\".\n"
+           << "Create a variable i. Set i to 0.\n"
+           << "While i is lower than " << scaled(scale, 20000) << " do:\n"
+           << "Set s to s plus \"abc\".\n"
+           << "Set i to i plus 1.\n"
+           << "That's all.\n";
+        return ss.str();
+    }
+
+    std::string deepCalls(double scale)
+    {
+        std::ostringstream ss;
+        ss << "Create a variable calls. Set calls to 0.\n"
+           << "Create a function Deep with argument n.\n"
+           << "When calling Deep do:\n"
+           << "If n is greater than 0 then:\n"
+           << "Set calls to calls plus 1.\n"
+           << "Deep n minus 1.\n"
+           // Keeps the recursive call out of tail position
+           << "Set calls to calls plus 0.\n"
+           << "That's all.\n"
+           << "That's all.\n"
+           << "Create a variable r. Set r to 0.\n"
+           << "While r is lower than " << scaled(scale, 200) << " do:\n"
+           << "Deep 500.\n"
+           << "Set r to r plus 1.\n"
+           << "That's all.\n";
+        return ss.str();
+    }
+
+    std::string wideCalls(double scale)
+    {
+        const std::size_t width = 200;
+        std::ostringstream ss;
+        ss << "Create a variable v. Set v to 0.\n";
+        for(std::size_t f = 0; f < width; ++f) {
+            ss << "Create a function F" << f << " with argument n.\n"
+               << "When calling F" << f << " do: Set n to n plus 1. That's all.\n";
+        }
+        ss << "Create a variable r. Set r to 0.\n"
+           << "While r is lower than " << scaled(scale, 200) << " do:\n";
+        for(std::size_t f = 0; f < width; ++f)
+            ss << "F" << f << " v.\n";
+        ss << "Set r to r plus 1.\n"
+           << "That's all.\n";
+        return ss.str();
+    }
+
+    std::string nestedBlocks(double scale)
+    {
+        const std::size_t depth = 64;
+        std::ostringstream ss;
+        ss << "Create a variable i. Set i to 0.\n"
+           << "Create a variable x. Set x to 0.\n"
+           << "While i is lower than " << scaled(scale, 5000) << " do:\n";
+        for(std::size_t d = 0; d < depth; ++d)
+            ss << "If i is greater than " << d << " or i equals " << d << " then:\n";
+        ss << "Set x to x plus 1.\n";
+        for(std::size_t d = 0; d < depth; ++d)
+            ss << "That's all.\n";
+        ss << "Set i to i plus 1.\n"
+           << "That's all.\n";
+        return ss.str();
+    }
+
+    std::string longSource(double scale)
+    {
+        const std::size_t lines = scaled(scale, 100000);
+        std::ostringstream ss;
+        ss << "Create a variable x. Set x to 0.\n"
+           << "Create a variable s. Set s to \"\".\n";
+        for(std::size_t l = 0; l < lines; ++l) {
+            if(l % 10 == 0)
+                ss << "Note: a comment the lexer has to skip.\n";
+            if(l % 7 == 0)
+                ss << "Set the value of s to \"word " << l << "\".\n";
+            else
+                ss << "Set the value of x to x plus " << l << " times ( "
+                   << l % 13 << " minus one ).\n";
+        }
+        return ss.str();
+    }
+
+    std::string manyVariables(double scale)
+    {
+        const std::size_t count = 2000;
+        std::ostringstream ss;
+        ss << "Create a variable total. Set total to 0.\n";
+        for(std::size_t v = 0; v < count; ++v)
+            ss << "Create a variable v" << v << ". Set v" << v << " to " << v << ".\n";
+        ss << "Create a variable r. Set r to 0.\n"
+           << "While r is lower than " << scaled(scale, 50) << " do:\n";
+        for(std::size_t v = 0; v < count; ++v)
+            ss << "Set total to total plus v" << v << ".\n";
+        ss << "Set r to r plus 1.\n"
+           << "That's all.\n";
+        return ss.str();
+    }
+
+    const Workload workloads[] = {
+        { "numeric_loop", "a tight While loop of number arithmetic", numericLoop },
+        { "string_concat", "appending to a string in a loop", stringConcat },
+        { "deep_calls", "recursion 500 calls deep", deepCalls },
+        { "wide_calls", "calling 200 different functions in a loop", wideCalls },
+        { "nested_blocks", "64 nested If blocks in a loop", nestedBlocks },
+        { "long_source", "100000 straight-line statements", longSource },
+        { "many_variables", "2000 variables summed in a loop", manyVariables },
+    };
+
+    double since(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    Times run(const std::string& path, const std::string& engine)
+    {
+        Times t;
+        Clock::time_point start = Clock::now();
+        Lexer lex(path);
+        TokenStream ts = lex.tokenize();
+        t.lex = since(start);
+        t.tokens = ts.size();
+
+        DataHandler data;
+        Ast::Program program;
+        start = Clock::now();
+        Parser parser(ts, data, program.getArena());
+        program.setRoot(parser.run());
+        t.parse = since(start);
+
+        start = Clock::now();
+        Resolver resolver(data);
+        resolver.resolve(program.getRoot());
+        Optimizer(data, resolver, program.getArena()).optimize(program.getRoot());
+        t.resolve = since(start);
+
+        start = Clock::now();
+        if(engine == "vm") {
+            Bytecode::Program code;
+            Bytecode::Compiler(code).compileProgram(program.getRoot());
+            Bytecode::VM(data, code).execute();
+        } else {
+            program.getRoot().execute();
+        }
+        t.execute = since(start);
+        return t;
+    }
+
+    void best(Times& result, const Times& t)
+    {
+        result.lex = std::min(result.lex, t.lex);
+        result.parse = std::min(result.parse, t.parse);
+        result.resolve = std::min(result.resolve, t.resolve);
+        result.execute = std::min(result.execute, t.execute);
+    }
+}
+
+int main(int argc, char const* argv[])
+{
+    int repeat = 5;
+    double scale = 1.0;
+    std::string engine = "ast";
+    bool keep = false;
+    std::vector<std::string> selected;
+    for(int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if(arg.compare(0, 9, "--repeat=") == 0)
+            repeat = std::max(1, std::atoi(arg.c_str() + 9));
+        else if(arg.compare(0, 8, "--scale=") == 0)
+            scale = std::atof(arg.c_str() + 8);
+        else if(arg.compare(0, 9, "--engine=") == 0)
+            engine = arg.substr(9);
+        else if(arg == "--no-jit")
+            Jit::setEnabled(false);
+        else if(arg == "--keep")
+            keep = true;
+        else
+            selected.push_back(arg);
+    }
+    if(engine != "ast" && engine != "vm") {
+        std::cerr << "unknown engine \"" << engine << "\" (use vm or ast)" << std::endl;
+        return 2;
+    }
+
+    char dir_template[] = "/tmp/notenglish_bench.XXXXXX";
+    const char* dir = ::mkdtemp(dir_template);
+    if(!dir) {
+        std::cerr << "could not create a directory for the workloads" << std::endl;
+        return 1;
+    }
+
+    std::ostringstream json;
+    json << "{\n  \"engine\": \"" << engine << "\",\n  \"jit\": "
+         << (Jit::enabled() ? "true" : "false") << ",\n  \"repeat\": " << repeat
+         << ",\n  \"scale\": " << scale << ",\n  \"workloads\": [";
+    bool first = true;
+    int status = 0;
+    for(const Workload& w : workloads) {
+        if(!selected.empty()
+           && std::find(selected.begin(), selected.end(), w.name) == selected.end())
+            continue;
+        const std::string path = std::string(dir) + "/" + w.name + ".ext";
+        const std::string source = w.generate(scale);
+        std::ofstream(path.c_str(), std::ios::binary) << source;
+        try {
+            Times result = run(path, engine);
+            for(int r = 1; r < repeat; ++r)
+                best(result, run(path, engine));
+            json << (first ? "\n" : ",\n")
+                 << "    {\"name\": \"" << w.name << "\", \"description\": \""
+                 << w.description << "\", \"bytes\": " << source.size()
+                 << ", \"tokens\": " << result.tokens
+                 << ", \"lex_ms\": " << result.lex
+                 << ", \"parse_ms\": " << result.parse
+                 << ", \"resolve_ms\": " << result.resolve
+                 << ", \"execute_ms\": " << result.execute << "}";
+            first = false;
+        } catch(const std::exception& e) {
+            std::cerr << w.name << ": " << e.what() << std::endl;
+            status = 1;
+        }
+        if(!keep)
+            std::remove(path.c_str());
+    }
+    json << "\n  ]\n}\n";
+    std::cout << json.str();
+    if(!keep)
+        ::rmdir(dir);
+    else
+        std::cerr << "workloads kept in " << dir << std::endl;
+    return status;
+}
@@ -0,0 +1,22 @@
+#!/bin/sh
+# Training run of the profile-guided build (see CMakeLists.txt): runs the
+# examples and the benchmarks with the instrumented binaries in $1, on both
+# engines. Clang profiles are merged with llvm-profdata ($3) into $2.
+bin=$1
+profiles=$2
+profdata=$3
+examples=$(dirname "$0")/../examples
+
+for f in "$examples"/*.ext; do
+    for engine in ast vm; do
+        # Enough numbers for every example that asks for input
+        seq 1 100 | "$bin/NotEnglish" --engine=$engine "$f" > /dev/null
+    done
+done
+"$bin/NotEnglish_bench" --repeat=1 > /dev/null
+"$bin/NotEnglish_bench" --repeat=1 --no-jit > /dev/null
+"$bin/NotEnglish_bench" --repeat=1 --engine=vm > /dev/null
+
+if [ -n "$profdata" ]; then
+    "$profdata" merge -output="$profiles/default.profdata" "$profiles"/*.profraw
+fi
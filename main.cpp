@@ -1,25 +1,174 @@
 #include "TokenHandler.h"
+#include "Compiler.h"
+#include "VM.h"
+#include "Resolver.h"
+#include "Optimizer.h"
+#include "Output.h"
+#include "Streamer.h"
+#include "Cache.h"
+#include "Profiler.h"
+#include "ParallelParser.h"
+#include "Batch.h"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
 #include <stdexcept>
 #include <iostream>
+#include <thread>
+#include <vector>
+
+/**
+ * Prints the allocation counts (for --stats).
+ */
+static void printStats(const Ast::Program& program)
+{
+    const Pool::Stats vars = Pool::getStats();
+    std::size_t nodes = program.getArena().getAllocations();
+    std::size_t bytes = program.getArena().getBytes();
+    std::size_t chunks = program.getArena().getChunks();
+    for(const auto& arena : program.getArenas()) {
+        nodes += arena->getAllocations();
+        bytes += arena->getBytes();
+        chunks += arena->getChunks();
+    }
+    std::cerr << "ast nodes: " << nodes << " (" << bytes << " bytes in "
+              << chunks << " chunks)\n"
+              << "variable cells: " << vars.allocations << " allocated, "
+              << vars.peak << " peak, " << vars.live << " live ("
+              << vars.chunks << " chunks)" << std::endl;
+}
+
+/**
+ * Runs the front end on the program in \a filename: lexes and parses it
+ * on up to \a jobs threads, resolves it into \a program and folds its
+ * constants if \a optimize.
+ */
+static void parse(const std::string& filename, DataHandler& data,
+                  Ast::Program& program, bool optimize, unsigned jobs)
+{
+    program.setRoot(ParallelParser(filename, data, jobs).run(program));
+    Resolver resolver(data);
+    resolver.resolve(program.getRoot());
+    if(optimize)
+        Optimizer(data, resolver, program.getArena()).optimize(program.getRoot());
+}
 
 int main (int argc, char const* argv[])
 {
     try {
-        if(argc < 2) {
+        std::string filename;
+        std::string engine = "ast";
+        bool stats = false;
+        bool optimize = true;
+        bool stream = false;
+        bool cache = false;
+        bool profile = false;
+        bool batch = false;
+        std::vector<std::string> paths;
+        std::string profile_path = "profile.folded";
+        unsigned jobs = std::max(std::thread::hardware_concurrency(), 1u);
+        for(int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if(arg.compare(0, 9, "--engine=") == 0)
+                engine = arg.substr(9);
+            else if(arg == "--stats")
+                stats = true;
+            else if(arg == "--no-jit")
+                Jit::setEnabled(false);
+            else if(arg == "--unbuffered")
+                Output::standard().setBuffered(false);
+            else if(arg == "--stream")
+                stream = true;
+            else if(arg == "--cache")
+                cache = true;
+            else if(arg == "--batch")
+                batch = true;
+            else if(arg == "--profile")
+                profile = true;
+            else if(arg.compare(0, 10, "--profile=") == 0) {
+                profile = true;
+                profile_path = arg.substr(10);
+            }
+            else if(arg.compare(0, 7, "--jobs=") == 0)
+                jobs = std::max(std::atoi(arg.c_str() + 7), 1);
+            else if(arg == "-O0" || arg == "-O1")
+                optimize = arg == "-O1";
+            else {
+                filename = arg;
+                paths.push_back(arg);
+            }
+        }
+        if(filename.empty()) {
             std::cerr << "please supply filename" << std::endl;
             return 2;
         }
-        Lexer lex(argv[1]);
+        if(engine != "ast" && engine != "vm") {
+            std::cerr << "unknown engine \"" << engine << "\" (use vm or ast)" << std::endl;
+            return 2;
+        }
+        if(batch) {
+            if(stream || cache || profile) {
+                std::cerr << "--batch cannot be combined with --stream, --cache or --profile"
+                          << std::endl;
+                return 2;
+            }
+            BatchRunner runner(paths, engine, optimize, jobs);
+            return runner.run(std::cout, std::cerr) != 0;
+        }
+        if(profile && engine != "ast") {
+            std::cerr << "--profile only profiles the syntax tree (--engine=ast)" << std::endl;
+            return 2;
+        }
+        if(stream) {
+            if(engine != "ast") {
+                std::cerr << "--stream only runs on the syntax tree (--engine=ast)" << std::endl;
+                return 2;
+            }
+            DataHandler data;
+            Streamer streamer(filename, data, optimize);
+            // Reports once the program is done, before the syntax tree is
+            // gone
+            std::unique_ptr<Profiler::Session> session;
+            if(profile)
+                session.reset(new Profiler::Session(std::cerr, profile_path));
+            streamer.run();
+            Output::standard().flush();
+            session.reset();
+            return 0;
+        }
+        if(cache && (engine != "vm" || filename == "-")) {
+            std::cerr << "--cache only keeps the bytecode of a file (--engine=vm)" << std::endl;
+            return 2;
+        }
         DataHandler data;
-        TokenStream ts = lex.tokenize();
-        Parser parser(ts, data);
-
-        std::unique_ptr<Ast::Block> program(parser.run());
-        program->execute();
-    } catch(const boost::bad_any_cast& e) {
-        std::cerr << "Invalid value casting." << std::endl;
-        return 1;
+        Ast::Program program;
+        std::unique_ptr<Profiler::Session> session;
+        if(engine == "vm") {
+            Bytecode::Program code;
+            std::unique_ptr<Bytecode::Cache> image;
+            if(cache)
+                image.reset(new Bytecode::Cache(filename, optimize));
+            if(!image || !image->load(code)) {
+                parse(filename, data, program, optimize, jobs);
+                Bytecode::Compiler(code).compileProgram(program.getRoot());
+                if(image)
+                    image->save(code);
+            }
+            Bytecode::VM(data, code).execute();
+        } else {
+            parse(filename, data, program, optimize, jobs);
+            if(profile)
+                session.reset(new Profiler::Session(std::cerr, profile_path));
+            program.getRoot().execute();
+            Output::standard().flush();
+            session.reset();
+        }
+        if(stats) {
+            Output::standard().flush();
+            printStats(program);
+        }
     } catch(const std::exception& e) {
+        Output::standard().flush();
         std::cerr << "exception caught: " << e.what() << std::endl;
         return 1;
     }
@@ -0,0 +1,37 @@
+/**
+ * @file batch.cpp Runs the programs in a directory (tests/batch) as
+ * --batch does, on both engines: one failing program, here by calling a
+ * function that was never implemented, must not keep the others from
+ * running and printing.
+ */
+#include "Batch.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    if(argc != 2) {
+        std::cerr << "usage: test_batch DIRECTORY" << std::endl;
+        return 2;
+    }
+    const std::string dir = argv[1];
+    const std::string expected_out =
+        "==> " + dir + "/1_first.ext <==\nfirst\n"
+        "==> " + dir + "/2_unimplemented.ext <==\nbefore\n"
+        "==> " + dir + "/3_last.ext <==\n42\n";
+    const std::string expected_err =
+        "==> " + dir + "/2_unimplemented.ext <==\n"
+        "exception caught: Undefined function Missing used.\n";
+    int failures = 0;
+    for(const char* engine : { "ast", "vm" }) {
+        std::ostringstream out, err;
+        const std::size_t failed = BatchRunner({ dir }, engine, true, 2).run(out, err);
+        if(failed != 1 || out.str() != expected_out || err.str() != expected_err) {
+            ++failures;
+            std::cerr << engine << ": " << failed << " failed, printed\n"
+                << out.str() << "reported\n" << err.str() << std::endl;
+        }
+    }
+    return failures ? 1 : 0;
+}
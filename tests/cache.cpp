@@ -0,0 +1,175 @@
+/**
+ * @file cache.cpp Saves the bytecode of programs to images and loads them
+ * back: an image loads as it was saved, and one whose instructions refer
+ * past the registers, code or tables of the program (with a checksum that
+ * still matches) is refused, so the program is compiled instead.
+ */
+#include "Cache.h"
+#include "Interpreter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+using namespace Bytecode;
+
+namespace {
+
+    int failures = 0;
+
+    void fail(const std::string& what)
+    {
+        ++failures;
+        std::cerr << what << std::endl;
+    }
+
+    /**
+     * A copy of a program in a temporary file, its image is next to it.
+     */
+    class Script {
+        std::string path;
+    public:
+        explicit Script(const std::string& source)
+            : path()
+        {
+            char name[] = "/tmp/notenglish-cacheXXXXXX";
+            const int fd = ::mkstemp(name);
+            if(fd >= 0)
+                ::close(fd);
+            path = name;
+            std::ofstream(path.c_str(), std::ios::binary) << source;
+        }
+
+        ~Script()
+        {
+            std::remove(path.c_str());
+            std::remove((path + "c").c_str());
+        }
+
+        const std::string& getPath() const
+        {
+            return path;
+        }
+    };
+
+    bool same(const Program& x, const Program& y)
+    {
+        if(x.chunks.size() != y.chunks.size() || x.names != y.names
+           || x.constants.size() != y.constants.size())
+            return false;
+        for(std::size_t i = 0; i < x.chunks.size(); ++i) {
+            const std::vector<Instruction>& a = x.chunks[i].code;
+            const std::vector<Instruction>& b = y.chunks[i].code;
+            if(a.size() != b.size())
+                return false;
+            for(std::size_t j = 0; j < a.size(); ++j) {
+                if(a[j].op != b[j].op || a[j].a != b[j].a || a[j].b != b[j].b
+                   || a[j].c != b[j].c)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Saves \a source compiled and loads it back.
+     */
+    void roundTrip(const std::string& name, const std::string& source)
+    {
+        Script script(source);
+        const Program program = *Interpreter::compile(source);
+        Cache cache(script.getPath(), true);
+        cache.save(program);
+        Program loaded;
+        if(!cache.load(loaded))
+            fail(name + ": the image was refused");
+        else if(!same(program, loaded))
+            fail(name + ": the image changed");
+    }
+
+    /**
+     * Saves \a source compiled and damaged by \a damage, which has to find
+     * something to damage, the image may not load.
+     */
+    void refused(const std::string& what, const std::string& source,
+                 const std::function<bool(Program&)>& damage)
+    {
+        Script script(source);
+        Program program = *Interpreter::compile(source);
+        if(!damage(program)) {
+            fail(what + ": nothing to damage");
+            return;
+        }
+        Cache cache(script.getPath(), true);
+        cache.save(program);
+        Program loaded;
+        if(cache.load(loaded))
+            fail(what + ": the image was loaded");
+    }
+
+    /**
+     * @return a damage of the first instruction with \a op
+     */
+    std::function<bool(Program&)> first(OpCode op,
+        const std::function<void(const Program&, Chunk&, Instruction&)>& damage)
+    {
+        return [op, damage](Program& program) {
+            for(Chunk& chunk : program.chunks) {
+                for(Instruction& ins : chunk.code) {
+                    if(ins.op == op) {
+                        damage(program, chunk, ins);
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+    }
+
+    // Uses every kind of operand
+    const std::string program =
+        "Create a function called Twice with argument n.\n"
+        "Upon calling Twice do:\n"
+        "Display n times 2 and a newline.\n"
+        "That's all.\n"
+        "Create a variable i. Set the value of i to 0.\n"
+        "While i is smaller than 3 do:\n"
+        "Twice i. Set the value of i to i plus 1.\n"
+        "That's all.\n";
+}
+
+int main(int argc, char** argv)
+{
+    roundTrip("program", program);
+    for(int i = 1; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::ostringstream ss;
+        ss << file.rdbuf();
+        roundTrip(argv[i], ss.str());
+    }
+    refused("register", program, first(OpCode::Add,
+        [](const Program&, Chunk& chunk, Instruction& ins) { ins.b = chunk.registers; }));
+    refused("jump", program, first(OpCode::Jump,
+        [](const Program&, Chunk& chunk, Instruction& ins) { ins.c = chunk.code.size(); }));
+    refused("constant", program, first(OpCode::LoadConst,
+        [](const Program& p, Chunk&, Instruction& ins) { ins.c = p.constants.size(); }));
+    refused("name", program, first(OpCode::Call,
+        [](const Program& p, Chunk&, Instruction& ins) { ins.c = p.names.size(); }));
+    refused("function", program, first(OpCode::DeclareFunc,
+        [](const Program& p, Chunk&, Instruction& ins) { ins.c = p.functions.size(); }));
+    refused("chunk", program, first(OpCode::ImplementFunc,
+        [](const Program& p, Chunk&, Instruction& ins) { ins.b = p.chunks.size(); }));
+    refused("scope", program, first(OpCode::EnterScope,
+        [](const Program& p, Chunk&, Instruction& ins) { ins.c = p.scopes.size(); }));
+    refused("end", program, [](Program& p) {
+        p.chunks.back().code.pop_back();
+        return true;
+    });
+    if(failures)
+        std::cerr << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
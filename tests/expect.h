@@ -0,0 +1,153 @@
+/**
+ * @file expect.h What the tests running programs share: a session keeping
+ * the output of an ::Interpreter, and checks of what a program prints on
+ * both engines, the syntax tree and the virtual machine, and when it is
+ * run while it is read (see ::Streamer).
+ */
+#ifndef _NOTENGLISH_TESTS_EXPECT_H_INCLUDE_GUARD
+#define _NOTENGLISH_TESTS_EXPECT_H_INCLUDE_GUARD
+
+#include "Interpreter.h"
+#include "Streamer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+namespace tests {
+
+    enum class Engine {
+        Ast, VM, Stream
+    };
+
+    const Engine engines[] = { Engine::Ast, Engine::VM, Engine::Stream };
+
+    inline const char* engineName(Engine engine)
+    {
+        switch(engine) {
+        case Engine::Ast:
+            return "ast";
+        case Engine::VM:
+            return "vm";
+        default:
+            return "stream";
+        }
+    }
+
+    /**
+     * An ::Interpreter keeping what its programs print, they read no
+     * input. Streamed programs run on a state of their own.
+     */
+    class Session {
+        std::string out;
+        Interpreter interpreter;
+
+        /**
+         * Runs \a source with a ::Streamer, from a temporary file.
+         */
+        void stream(const std::string& source)
+        {
+            char path[] = "/tmp/notenglish-testXXXXXX";
+            const int fd = ::mkstemp(path);
+            if(fd < 0)
+                throw std::runtime_error("could not create a temporary file");
+            ::close(fd);
+            std::ofstream(path, std::ios::binary) << source;
+            std::ostream discard(nullptr);
+            std::ostream* const log = setErrorLog(&discard);
+            Output::Stream output([this](const char* data, std::size_t size) {
+                out.append(data, size);
+            });
+            try {
+                DataHandler data;
+                data.setIO(output, [](std::string&) { return false; });
+                Streamer(path, data, true).run();
+            } catch(...) {
+                output.flush();
+                setErrorLog(log);
+                std::remove(path);
+                throw;
+            }
+            output.flush();
+            setErrorLog(log);
+            std::remove(path);
+        }
+    public:
+        Session()
+            : out(), interpreter([this](const char* data, std::size_t size) {
+                  out.append(data, size);
+              }, [](std::string&) { return false; }) {}
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        /**
+         * Runs \a source on \a engine.
+         * @return what it printed, followed by "error: " and the message
+         *  if it failed
+         */
+        std::string run(const std::string& source, Engine engine)
+        {
+            out.clear();
+            try {
+                if(engine == Engine::Ast)
+                    interpreter.runSource(source);
+                else if(engine == Engine::VM)
+                    interpreter.run(Interpreter::compile(source));
+                else
+                    stream(source);
+            } catch(const std::exception& e) {
+                out += std::string("error: ") + e.what();
+            }
+            return out;
+        }
+    };
+
+    inline int& failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    /**
+     * Runs \a source in \a session on both engines and streamed, each has
+     * to print \a expected.
+     */
+    inline void expect(Session& session, const std::string& source,
+                       const std::string& expected)
+    {
+        for(Engine engine : engines) {
+            const std::string out = session.run(source, engine);
+            if(out == expected)
+                continue;
+            ++failures();
+            std::cerr << "\"" << source << "\" on " << engineName(engine)
+                << ":\n printed \"" << out << "\"\n expected \"" << expected
+                << "\"" << std::endl;
+        }
+    }
+
+    /**
+     * Runs \a source in a new session on both engines and streamed.
+     */
+    inline void expect(const std::string& source, const std::string& expected)
+    {
+        Session session;
+        expect(session, source, expected);
+    }
+
+    /**
+     * @return the exit status of the test, after reporting its failures
+     */
+    inline int finish()
+    {
+        if(failures() == 0)
+            return 0;
+        std::cerr << failures() << " failed" << std::endl;
+        return 1;
+    }
+}
+
+#endif // _NOTENGLISH_TESTS_EXPECT_H_INCLUDE_GUARD
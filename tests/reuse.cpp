@@ -0,0 +1,41 @@
+/**
+ * @file reuse.cpp Runs programs one after another on the same
+ * ::Interpreter, on both engines, which keeps its state (the variables and
+ * the memory of the virtual machine) between runs: a run has to start
+ * afresh, also after a run that failed in the middle of calls.
+ */
+#include "expect.h"
+#include <string>
+
+int main()
+{
+    // Counts down from n, deeper than the frames and registers reserved
+    const std::string count =
+        "Create a function called Count with argument n.\n"
+        "Upon calling Count do:\n"
+        "If n is greater than zero then:\n"
+        "Create a variable m. Set the value of m to n minus one.\n"
+        "Count m.\n"
+        "Set the value of n to m.\n"
+        "That's all.\n"
+        "That's all.\n"
+        "Create a variable n. Set the value of n to 5000.\n"
+        "Count n. Display n and a newline.\n";
+    // Fails with calls and pushed arguments pending
+    const std::string fail =
+        "Create a function called Down with argument n.\n"
+        "Upon calling Down do:\n"
+        "If n is greater than zero then:\n"
+        "Create a variable m. Set the value of m to n minus one.\n"
+        "Down m.\n"
+        "That's all.\n"
+        "Display \"at the bottom\", q.\n"
+        "That's all.\n"
+        "Down 300.\n";
+    tests::Session session;
+    for(int i = 0; i < 3; ++i) {
+        tests::expect(session, count, "0\n");
+        tests::expect(session, fail, "error: Undefined variable q used.");
+    }
+    return tests::finish();
+}
@@ -0,0 +1,94 @@
+/**
+ * @file scoping.cpp Runs programs whose functions use variables they do not
+ * see lexically: those are looked up among the variables of their callers.
+ * Tail calls drop the scopes of the caller, unless such a lookup may need
+ * them. A function may not declare a variable of the program, even one
+ * declared after it.
+ */
+#include "expect.h"
+#include <string>
+
+using tests::expect;
+
+namespace {
+
+    // Peek displays z, which it does not declare
+    const std::string peek =
+        "Create a function called Peek.\n"
+        "Upon calling Peek do:\n"
+        "Display z and a newline.\n"
+        "That's all.\n";
+}
+
+int main()
+{
+    // The caller's variable, Peek is not its last statement
+    expect(peek +
+        "Create a function called Outer.\n"
+        "Upon calling Outer do:\n"
+        "Create a variable z. Set the value of z to 42.\n"
+        "Peek. Display \"end\".\n"
+        "That's all.\n"
+        "Outer.\n", "42\nend");
+    // The innermost caller's variable, through a call in a block
+    expect(peek +
+        "Create a function called Inner.\n"
+        "Upon calling Inner do:\n"
+        "Create a variable z. Set the value of z to 2.\n"
+        "If z equals 2 then: Peek. That's all.\n"
+        "That's all.\n"
+        "Create a function called Outer.\n"
+        "Upon calling Outer do:\n"
+        "Create a variable z. Set the value of z to 1.\n"
+        "Peek. Inner. Peek.\n"
+        "That's all.\n"
+        "Outer.\n", "1\n2\n1\n");
+    // Setting a variable of the caller
+    expect("Create a function called Bump.\n"
+        "Upon calling Bump do:\n"
+        "Set the value of y to y plus one.\n"
+        "That's all.\n"
+        "Create a function called Outer.\n"
+        "Upon calling Outer do:\n"
+        "Create a variable y. Set the value of y to 10.\n"
+        "Bump. Bump. Display y and a newline.\n"
+        "That's all.\n"
+        "Outer.\n", "12\n");
+    // No caller has the variable
+    expect(peek + "Peek.\n", "error: Undefined variable z used.");
+    // A variable of the program declared after the function shadowing it
+    expect("Create a function called Own.\n"
+        "Upon calling Own do:\n"
+        "Create a variable x. Set the value of x to 5.\n"
+        "Display x and a newline.\n"
+        "That's all.\n"
+        "Create a variable x. Set the value of x to 1.\n"
+        "Own. Display x and a newline.\n", "error: Variable x double declared.");
+    // The same, with the variable read by a callee
+    expect(peek +
+        "Create a function called Outer.\n"
+        "Upon calling Outer do:\n"
+        "Create a variable z. Set the value of z to 5.\n"
+        "Peek.\n"
+        "That's all.\n"
+        "Create a variable z. Set the value of z to 1.\n"
+        "Outer.\n", "error: Variable z double declared.");
+    // A tail call, its caller's variable is still seen
+    expect(peek +
+        "Create a function called Outer.\n"
+        "Upon calling Outer do:\n"
+        "Create a variable z. Set the value of z to 7.\n"
+        "Peek.\n"
+        "That's all.\n"
+        "Outer.\n", "7\n");
+    // Tail calls too deep for the host stack, as no name is looked up
+    expect("Create a function called Down with argument n.\n"
+        "Upon calling Down do:\n"
+        "If n is greater than zero then:\n"
+        "Create a variable m. Set the value of m to n minus one.\n"
+        "Down m.\n"
+        "That's all.\n"
+        "That's all.\n"
+        "Down 200000. Display \"down\".\n", "down");
+    return tests::finish();
+}
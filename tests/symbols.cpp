@@ -0,0 +1,42 @@
+/**
+ * @file symbols.cpp Compiles many programs with names and literals of their
+ * own: the symbol tables have to give them back once the programs are
+ * compiled.
+ */
+#include "Interpreter.h"
+#include "Arena.h"
+#include <iostream>
+#include <string>
+
+int main()
+{
+    const std::size_t programs = 1000;
+    const std::size_t before = Symbols::count();
+    std::size_t most = before;
+    for(std::size_t i = 0; i < programs; ++i) {
+        const std::string n = std::to_string(i);
+        Interpreter::Script script = Interpreter::compile(
+            "Create a variable called v" + n + ".\n"
+            "Set the value of v" + n + " to \"the literal number " + n + "\".\n"
+            "Create a function called F" + n + ".\n"
+            "Upon calling F" + n + " do:\n"
+            "Display v" + n + " and a newline.\n"
+            "That's all.\n"
+            "F" + n + ".\n");
+        if(Symbols::count() > most)
+            most = Symbols::count();
+    }
+    if(most != before) {
+        std::cerr << programs << " programs left " << most - before
+            << " names and literals in the symbol tables" << std::endl;
+        return 1;
+    }
+
+    Arena arena;
+    const std::string& name = arena.getSymbols().intern("name");
+    if(&arena.getSymbols().intern("name") != &name || Symbols::count() != before + 1) {
+        std::cerr << "a name was not kept once" << std::endl;
+        return 1;
+    }
+    return 0;
+}
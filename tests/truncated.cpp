@@ -0,0 +1,107 @@
+/**
+ * @file truncated.cpp Compiles programs cut short at every byte: each one
+ * has to compile or be rejected with a ::ParseError, never read past its
+ * tokens (run it with -fsanitize=address to see that). Programs with a
+ * token of the wrong kind are rejected the same way.
+ */
+#include "Interpreter.h"
+#include "TokenStream.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+    int failures = 0;
+
+    void fail(const std::string& source, const std::string& what)
+    {
+        if(++failures <= 10)
+            std::cerr << "\"" << source << "\": " << what << std::endl;
+    }
+
+    /**
+     * @return whether \a source compiled
+     */
+    bool compiles(const std::string& source)
+    {
+        try {
+            Interpreter::compile(source);
+            return true;
+        } catch(const ParseError& e) {
+            if(e.getLine() <= 0)
+                fail(source, "no line in the error");
+        } catch(const std::exception& e) {
+            fail(source, std::string("not a ParseError: ") + e.what());
+        }
+        return false;
+    }
+
+    // Unfinished sentences of every kind
+    const char* const unfinished[] = {
+        "N",
+        "Create",
+        "Create a variable",
+        "Create a variable called",
+        "Create a function called f with",
+        "Create a function called f with argument",
+        "Set the value of",
+        "Set the value of x",
+        "Set the value of x to",
+        "Set the value of x to 1 plus",
+        "Set the value of x to (1",
+        "Set the value of x to the result of",
+        "Set the value of x to the result of calling",
+        "Display",
+        "Display 1 and",
+        "If",
+        "If 1 equals",
+        "If 1 equals 1",
+        "If 1 equals 1 then:",
+        "If 1 equals 1 then: Display 1.",
+        "If 1 equals 1 then: Display 1. That's all. Otherwise",
+        "While 1 is lower than",
+        "While 1 is lower than 2 do:",
+        "Upon",
+        "Upon calling",
+        "Upon calling f do:",
+        "Create a variable x",
+        "Display \"unterminated",
+    };
+
+    // A number, a string or a name where another kind of token belongs
+    const char* const misplaced[] = {
+        "Set the value of x to (1 2.",
+        "Set the value of x to (1 \"a\".",
+        "Set the value of x to (1 y.",
+    };
+}
+
+int main(int argc, char** argv)
+{
+    for(const char* source : unfinished) {
+        if(compiles(source))
+            fail(source, "compiled");
+    }
+    for(const char* source : misplaced) {
+        if(compiles(source))
+            fail(source, "compiled");
+    }
+    // Every prefix of the given programs
+    for(int i = 1; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if(!file) {
+            std::cerr << "could not open " << argv[i] << std::endl;
+            return 1;
+        }
+        std::ostringstream ss;
+        ss << file.rdbuf();
+        const std::string program = ss.str();
+        for(std::size_t size = 0; size <= program.size(); ++size)
+            compiles(program.substr(0, size));
+    }
+    if(failures)
+        std::cerr << failures << " failed" << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file undefined.cpp Runs programs calling functions that were declared
+ * but never implemented, on both engines: the library reports an error,
+ * however the function is called, and the next run goes on as usual.
+ */
+#include "expect.h"
+#include <string>
+
+using tests::expect;
+
+namespace {
+
+    const std::string missing = "Create a function called Missing.\n";
+}
+
+int main()
+{
+    // A call as a statement
+    expect(missing +
+        "Display \"before\" and a newline.\n"
+        "Missing.\n"
+        "Display \"after\" and a newline.\n",
+        "before\nerror: Undefined function Missing used.");
+    // A tail call
+    expect(missing +
+        "Create a function called Go.\n"
+        "Upon calling Go do:\n"
+        "Display \"go\" and a newline.\n"
+        "Missing.\n"
+        "That's all.\n"
+        "Go.\n",
+        "go\nerror: Undefined function Missing used.");
+    // A call in an expression
+    expect(missing +
+        "Create a variable x.\n"
+        "Set the value of x to the result of calling Missing.\n",
+        "error: Undefined function Missing used.");
+    // The interpreter is still usable
+    tests::Session session;
+    tests::expect(session, missing + "Missing.\n", "error: Undefined function Missing used.");
+    tests::expect(session, "Display \"fine\".\n", "fine");
+    return tests::finish();
+}
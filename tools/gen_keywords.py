@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Generates Keywords.cpp: a perfect hash table of the keywords the Lexer
+knows of. Run it from the repository root after changing KEYWORDS:
+
+    python3 tools/gen_keywords.py > Keywords.cpp
+"""
+
+KEYWORDS = [
+    ("Declaration", ["Declare", "Create", "Make", "Construct", "Spawn",
+                     "Manufacture", "Name", "Label"]),
+    ("SetVar", ["Change", "Set", "Vary", "Alter", "Modify", "Adjust"]),
+    ("ValueOf", ["value"]),
+    ("Article", ["a", "an", "another", "the"]),
+    ("Or", ["or"]),
+    ("And", ["and"]),
+    ("To", ["to", "by", "into"]),
+    ("KnownAs", ["named", "called", "labeled", "titled"]),
+    ("End", ["Stop", "End", "Quit", "Exit"]),
+    # Operators written as words (not symbols)
+    ("Plus", ["plus"]),
+    ("Minus", ["minus"]),
+    ("Times", ["times"]),
+    ("If", ["If"]),
+    ("Else", ["Otherwise", "Else"]),
+    ("Equals", ["equals"]),
+    ("NotEquals", ["differs"]),
+    ("BlockEnd", ["That's"]),
+    ("BlockBegin", ["then:", "do:"]),
+    # Used as operator
+    ("Is", ["is"]),
+    ("FuncName", ["Call", "Execute", "Evaluate"]),
+    ("FuncResult", ["result", "outcome"]),
+    ("On", ["on", "with"]),
+    ("Of", ["of", "from"]),
+    ("While", ["While"]),
+    ("Comment", ["Note", "Notice", "Note:", "Notice:"]),
+    ("Argument", ["argument", "arguments", "parameter", "parameters"]),
+    ("When", ["When", "Whenever", "Upon"]),
+    ("Calling", ["calling", "executing", "evaluating", "running"]),
+]
+
+TABLE_BITS = 9
+
+
+def fnv1a(word, seed):
+    # Has to match keywordHash in the generated file
+    h = seed
+    for c in word.encode():
+        h = ((h ^ c) * 16777619) & 0xffffffff
+    return h >> (32 - TABLE_BITS)
+
+
+def find_seed(words):
+    seed = 2166136261
+    while len({fnv1a(w, seed) for w in words}) != len(words):
+        seed = (seed + 1) & 0xffffffff
+    return seed
+
+
+def main():
+    entries = [(word, t) for t, words in KEYWORDS for word in words]
+    assert len(entries) < 256
+    seed = find_seed([w for w, _ in entries])
+    slots = [0] * (1 << TABLE_BITS)
+    for i, (word, _) in enumerate(entries):
+        slots[fnv1a(word, seed)] = i + 1
+
+    out = []
+    out.append("// Generated by tools/gen_keywords.py, do not edit.")
+    out.append('#include "TokenStream.h"')
+    out.append("#include <cstdint>")
+    out.append("#include <cstring>")
+    out.append("")
+    out.append("namespace {")
+    out.append("    struct Keyword {")
+    out.append("        const char* word;")
+    out.append("        std::size_t length;")
+    out.append("        TokenType type;")
+    out.append("    };")
+    out.append("")
+    out.append("    const Keyword keywords[] = {")
+    out.append("        { \"\", 0, TokenType::Unkown },")
+    for word, t in entries:
+        out.append('        { "%s", %d, TokenType::%s },' % (word, len(word), t))
+    out.append("    };")
+    out.append("")
+    out.append("    const unsigned table_bits = %d;" % TABLE_BITS)
+    out.append("")
+    out.append("    // Index into keywords for each hash value (0 if none)")
+    out.append("    const std::uint8_t slots[1 << table_bits] = {")
+    for i in range(0, len(slots), 16):
+        out.append("        " + ", ".join("%d" % s for s in slots[i:i + 16]) + ",")
+    out.append("    };")
+    out.append("")
+    out.append("    // FNV-1a, seeded such that no two keywords collide")
+    out.append("    inline std::uint32_t keywordHash(const char* s, std::size_t n)")
+    out.append("    {")
+    out.append("        std::uint32_t h = %du;" % seed)
+    out.append("        for(std::size_t i = 0; i < n; ++i)")
+    out.append("            h = (h ^ static_cast<unsigned char>(s[i])) * 16777619u;")
+    out.append("        return h >> (32 - table_bits);")
+    out.append("    }")
+    out.append("}")
+    out.append("")
+    out.append("TokenType lookupKeyword(boost::string_view word)")
+    out.append("{")
+    out.append("    const Keyword& k = keywords[slots[keywordHash(word.data(), word.size())]];")
+    out.append("    if(k.length != word.size() || std::memcmp(k.word, word.data(), k.length) != 0)")
+    out.append("        return TokenType::Unkown;")
+    out.append("    return k.type;")
+    out.append("}")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()